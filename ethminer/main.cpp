@@ -367,27 +367,45 @@ public:
 	app.add_option("--sqrl-patience,--sqp", m_SQSettings.patience, "Cycles to wait for on-chip network congestion to resolve itself before intervention - 0 disables(Not Recommended)", true)->check(CLI::Range(0,255));
 	app.add_option("--sqrl-no-stalldetect", m_SQSettings.skipStallDetection,"",true);
 	app.add_option("--sqrl-work-delay", m_SQSettings.workDelay,"Time in microseconds to wait before updating work results", true)->check(CLI::Range(10000,1000000));
+	app.add_option("--sqrl-status-interval", m_SQSettings.statusInterval,"Time in milliseconds between hashcore counter polls", true)->check(CLI::Range(100,10000));
+	app.add_option("--sqrl-health-rate", m_SQSettings.healthShareRate, "Health shares per second to aim for, 0 keeps the fixed target", true)->check(CLI::Range(0.0,100.0));
+	app.add_flag("--sqrl-health", m_SQSettings.healthMonitor, "Enable statistical stall and degradation detection");
+	app.add_option("--sqrl-health-stall", m_SQSettings.healthStallAction, "Action on a stall: 0 - none, 1 - alert, 2 - reset core, 3 - downclock, 4 - re-DAG", true)->check(CLI::Range(0,4));
+	app.add_option("--sqrl-health-degrade", m_SQSettings.healthDegradeAction, "Action on a target check rate degradation (see --sqrl-health-stall)", true)->check(CLI::Range(0,4));
+	app.add_option("--sqrl-health-errors", m_SQSettings.healthErrorAction, "Action on a rising failed share ratio (see --sqrl-health-stall)", true)->check(CLI::Range(0,4));
+	app.add_option("--sqrl-health-link", m_SQSettings.healthLinkAction, "Action on repeated counter read failures (see --sqrl-health-stall)", true)->check(CLI::Range(0,4));
 	app.add_option("--sqrl-fk-vccint", m_SQSettings.fkVCCINT, "Voltage in millivolt to set FK VCCINT target to. Limit 750-920", true)->check(CLI::Range(0, 920));
 	app.add_option("--sqrl-jc-vccint", m_SQSettings.jcVCCINT, "Voltage in millivolt to set JC VCCINT target to. Limit 750-920", true)->check(CLI::Range(0, 920));
     app.add_flag("--sqrl-die-on-error", m_SQSettings.dieOnError, "Exit immediately on comm errors");
         
 
-	app.add_option("--sqrl-dag-mixers", m_SQSettings.dagMixers, "Number of DAG mixers in the loaded bitstream (Rarely Used)", true)->check(CLI::Range(1,16));
+	app.add_option("--sqrl-dag-mixers", m_SQSettings.dagMixers, "Number of DAG mixers in the loaded bitstream, 0 to use what it reports (Rarely Used)", true)->check(CLI::Range(0,16));
 	app.add_option("--sqrl-hbm-stats", m_SQSettings.showHBMStats, "Show HBM Temperature/Calibration stats", true);
 	app.add_flag("--sqrl-force-dag", m_SQSettings.forceDAG, "Force DAG to regenerate");
 	app.add_flag("--sqrl-skip-dag", m_SQSettings.skipDAG, "Bypass actual DAG generation (Results will be corrupt but hashrate accurate for tuning");
+	app.add_option("--sqrl-dag-verify", m_SQSettings.dagVerifySamples, "Number of random DAG items per HBM stack to verify against the host after generation - 0 disables", true)->check(CLI::Range(0,4096));
+	app.add_option("--sqrl-dag-verify-interval", m_SQSettings.dagVerifyInterval, "Minutes between periodic DAG verification while mining - 0 disables", true);
+	app.add_flag("--sqrl-warm-attach", m_SQSettings.warmAttach, "Resume boards left configured by a previous run without resetting clock or tune");
+	app.add_option("--sqrl-state-file", m_SQSettings.stateFile, "File recording the configuration, tune and history of each board", true);
 
 	// AXI Timeout control
 	app.add_option("--sqrl-axi-timeout", m_SQSettings.axiTimeoutMs, "AXI maximum latency in milliseconds", true);
+	app.add_option("--sqrl-probe-timeout", m_SQSettings.probeTimeoutMs, "Milliseconds to wait for each board during discovery - 0 skips discovery", true);
 
     //Tune
-    app.add_option("--auto-tune", m_SQSettings.autoTune, " 0 - no auto-tune, 1 - just reach max stable freq, 2 - downclock till low errror rate, 3 - tune intensity, 4- downclock voltage",true)->check(CLI::Range(0, 4));
+    app.add_option("--auto-tune", m_SQSettings.autoTune, " 0 - no auto-tune, 1 - just reach max stable freq, 2 - downclock till low errror rate, 3 - tune intensity, 4 - then lower VCCINT for hashes per joule",true)->check(CLI::Range(0, 4));
     app.add_option("--tune-time", m_SQSettings.tuneTime, " Tuning time per test in seconds",true)->check(CLI::Range(10, 10000000));
+    app.add_option("--tune-strategy", m_SQSettings.tuneStrategy, " 0 - staged (clock, error rate, then intensity), 1 - successive halving over clock, N, D and patience; levels 1-2 search the clock only",true)->check(CLI::Range(0, 1));
     app.add_option("--tune-max-clk", m_SQSettings.tuneMaxClk, " Tuning will not got higher than this clk, Mhz",true)->check(CLI::Range(300, 600));
+    app.add_option("--tune-min-vccint", m_SQSettings.tuneMinVCCINT, " Voltage tuning (--auto-tune 4) will not go lower than this VCCINT, mV",true)->check(CLI::Range(600, 900));
     app.add_option("--tune-exclude", m_SQSettings.tuneExclude, "Devices to exclude, space seperated", true);
     app.add_option("--tune-file", m_SQSettings.tuneFile, "File in the same directory containing tune files");
     app.add_option("--tune-maxcore-temp", m_SQSettings.tuneMaxCoreTemp, "Max core temp, in C", true);
     app.add_option("--tune-maxhbm-temp", m_SQSettings.tuneMaxHBMtemp, "Max HBM temp, in C", true);
+    app.add_option("--sqrl-thermal-core", m_SQSettings.thermalCoreTarget, "Core temperature the thermal governor holds, in C (0 disables)", true)->check(CLI::Range(0, 100));
+    app.add_option("--sqrl-thermal-hbm", m_SQSettings.thermalHBMTarget, "HBM temperature the thermal governor holds, in C (0 disables)", true)->check(CLI::Range(0, 100));
+    app.add_option("--sqrl-thermal-max-derate", m_SQSettings.thermalMaxDerate, "Percent of throughput the governor takes off by intensity before stepping the clock down", true)->check(CLI::Range(1, 90));
+    app.add_option("--sqrl-thermal-hysteresis", m_SQSettings.thermalHysteresis, "Degrees either side of a target within which the governor holds still", true)->check(CLI::Range(0, 10));
 
 #ifdef _WIN32
 	WSADATA wsaData;
@@ -397,7 +415,25 @@ public:
 
         app.add_flag("--noeval", m_FarmSettings.noEval, "");
 
-        app.add_option("-L,--dag-load-mode", m_FarmSettings.dagLoadMode, "", true)->check(CLI::Range(1));
+        app.add_option("-L,--dag-load-mode", m_FarmSettings.dagLoadMode, "", true)->check(CLI::Range(2));
+
+        app.add_option("--dag-load-concurrency", m_FarmSettings.dagLoadConcurrency, "", true);
+
+        app.add_option("--dag-load-power", m_FarmSettings.dagLoadPower, "", true);
+
+        app.add_option("--dag-load-watts", m_FarmSettings.dagLoadWatts, "", true)->check(CLI::Range(1, 10000));
+
+        app.add_option("--epoch-prestage", m_FarmSettings.epochPrestage, "", true)->check(CLI::Range(0, 30000));
+
+        app.add_option("--stats-outliers", m_FarmSettings.statsOutliers, "", true)->check(CLI::Range(2));
+
+        app.add_option("--stats-outlier-factor", m_FarmSettings.statsOutlierFactor, "", true)->check(CLI::Range(1.0, 100.0));
+
+        app.add_option("--miner-restarts", m_FarmSettings.minerRestarts, "", true)->check(CLI::Range(0, 1000));
+
+        app.add_option("--miner-stuck-timeout", m_FarmSettings.minerStuckTimeout, "", true);
+
+        app.add_option("--power-budget", m_FarmSettings.powerBudget, "", true);
 
         bool cl_miner = false;
         app.add_flag("-G,--opencl", cl_miner, "");
@@ -531,6 +567,10 @@ public:
             m_CUSettings.schedule = 4;
 #endif
 
+        // The budget is shared out on measured draw
+        if (m_FarmSettings.powerBudget)
+            m_FarmSettings.hwMon = 2;
+
         if (m_FarmSettings.tempStop)
         {
             // If temp threshold set HWMON at least to 1
@@ -1066,6 +1106,46 @@ public:
 		<< "     --sqrl-no-stalldetect Disables automatic stall detection and recovery" << endl
 	        << "     --sqrl-work-delay     Time in microseconds to wait between updating " << endl
 		<< "                           work results from the FPGA (10000-100000 typical)" << endl
+		<< "                           Acts as the minimum wait, longer while nonces are rare" << endl
+		<< "     --sqrl-hosts          Boards to mine on, each ip[:port], ip:port-port," << endl
+		<< "                           a.b.c.first-last[:port] or a.b.c.d/prefix[:port]" << endl
+		<< "     --sqrl-probe-timeout  Milliseconds each board gets to answer the discovery" << endl
+		<< "                           probe, run on all boards at once before mining. Boards" << endl
+		<< "                           not answering, or already listed (same DNA), are left" << endl
+		<< "                           out. 0 skips discovery (Default 3000)" << endl
+		<< endl
+		<< "     --sqrl-status-interval Milliseconds between hashcore counter polls used for" << endl
+		<< "                           stall detection, hashrate and tuning (Default 1000)" << endl
+		<< "     --sqrl-health-rate    Health shares per second each board should report, the" << endl
+		<< "                           target follows the hashrate (Default 0 - fixed target)" << endl
+		<< endl
+		<< "     --sqrl-health         Detect stalls, target check rate degradation against the" << endl
+		<< "                           clock x intensity model, rising failed shares and link" << endl
+		<< "                           problems (CUSUM/EWMA change detection)" << endl
+		<< "     --sqrl-health-stall   Action on each event: 0 none, 1 alert, 2 reset core," << endl
+		<< "     --sqrl-health-degrade 3 downclock one step, 4 re-DAG" << endl
+		<< "     --sqrl-health-errors  Defaults: stall 2, degrade 1, errors 3, link 1" << endl
+		<< "     --sqrl-health-link" << endl
+		<< endl
+		<< "     --sqrl-dag-verify     Random DAG items per HBM stack to check against the" << endl
+		<< "                           host after generation (0 disables)" << endl
+		<< "     --sqrl-dag-verify-interval Minutes between DAG checks while mining" << endl
+		<< endl
+		<< "     --sqrl-warm-attach    Resume boards still holding the DAG, clock and intensity" << endl
+		<< "                           recorded by a previous run, skipping clock reset and tuning" << endl
+		<< "     --sqrl-state-file     File recording the last configuration, tune, known good" << endl
+		<< "                           clock and error history of each board. A tune found" << endl
+		<< "                           there for the current voltages skips auto-tuning" << endl
+		<< "                           (Default sqrlstate.txt)" << endl
+		<< endl
+		<< "     --sqrl-thermal-core   Core / HBM temperature in C the thermal governor keeps" << endl
+		<< "     --sqrl-thermal-hbm    each board at (Default 0, not governed). Throughput is" << endl
+		<< "                           taken off by intensity first, the clock only comes" << endl
+		<< "                           down once that is exhausted" << endl
+		<< "     --sqrl-thermal-max-derate Percent of throughput taken off by intensity before" << endl
+		<< "                           stepping the clock down (Default 30)" << endl
+		<< "     --sqrl-thermal-hysteresis Degrees either side of the target the governor" << endl
+		<< "                           holds still (Default 2)" << endl
 		<< endl;
 	}
 
@@ -1133,10 +1213,44 @@ public:
                     "exits"
                  << endl
                  << "                        Must be combined with -G or -U or -X flags" << endl
-                 << "    -L,--dag-load-mode  INT[0 .. 1] Default = 0" << endl
+                 << "    -L,--dag-load-mode  INT[0 .. 2] Default = 0" << endl
                  << "                        Set DAG load mode. Can be one of:" << endl
                  << "                        0 Parallel load mode (each GPU independently)" << endl
                  << "                        1 Sequential load mode (one GPU after another)" << endl
+                 << "                        2 Scheduled load mode (bounded concurrency," << endl
+                 << "                          fastest devices first)" << endl
+                 << "    --dag-load-concurrency UINT Default = 0" << endl
+                 << "                        Max devices loading DAG at once in mode 2" << endl
+                 << "                        If zero it is derived from --dag-load-power" << endl
+                 << "    --dag-load-power    UINT Default = 0" << endl
+                 << "                        Watts available for DAG loads in mode 2" << endl
+                 << "    --dag-load-watts    UINT Default = 100" << endl
+                 << "                        Watts drawn by one device loading its DAG" << endl
+                 << "    --epoch-prestage    UINT[0 .. 30000] Default = 0" << endl
+                 << "                        Prepare the next epoch in background this many" << endl
+                 << "                        blocks before its boundary. Needs a pool which" << endl
+                 << "                        reports block height. If zero it is disabled" << endl
+                 << "    --stats-outliers    INT[0 .. 2] Default = 2" << endl
+                 << "                        How 10s hashrate samples far from the 10 min" << endl
+                 << "                        median are treated in the statistics windows:" << endl
+                 << "                        0 Keep, 1 Clip to the band, 2 Drop" << endl
+                 << "    --stats-outlier-factor FLOAT[1 .. 100] Default = 3" << endl
+                 << "                        Band is median / factor .. median * factor" << endl
+                 << "    --miner-restarts    UINT[0 .. 1000] Default = 5" << endl
+                 << "                        Restart a device whose miner failed (init or" << endl
+                 << "                        DAG error, or stuck) on its own, backing off" << endl
+                 << "                        from 5s to 5min. Given up after this many" << endl
+                 << "                        restarts within an hour. If zero it is disabled" << endl
+                 << "    --miner-stuck-timeout UINT Default = 300" << endl
+                 << "                        Seconds a device reporting progress may go" << endl
+                 << "                        without before it's restarted (SQRL). If zero" << endl
+                 << "                        only miners which exited are restarted" << endl
+                 << "    --power-budget      UINT Default = 0" << endl
+                 << "                        Watts all devices together may draw. Shared out" << endl
+                 << "                        every 30s, most hashes per watt first; SQRL" << endl
+                 << "                        boards held to their share by intensity, then" << endl
+                 << "                        clock (see --sqrl-thermal-max-derate). Implies" << endl
+                 << "                        --HWMON 2. If zero it is disabled" << endl
                  << endl
                  << "    --tstart            UINT[30 .. 100] Default = 0" << endl
                  << "                        Suspend mining on GPU which temperature is above"
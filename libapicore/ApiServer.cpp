@@ -713,6 +713,61 @@ void ApiConnection::processRequest(Json::Value& jRequest, Json::Value& jResponse
         }
     }
 
+    else if (_method == "miner_addsqrldevice")
+    {
+        if (!checkApiWriteAccess(m_readonly, jResponse))
+            return;
+
+        Json::Value jRequestParams;
+        if (!getRequestValue("params", jRequestParams, jRequest, false, jResponse))
+            return;
+
+        std::string host;
+        if (!getRequestValue("host", host, jRequestParams, false, jResponse))
+            return;
+
+        unsigned port = 2000;
+        if (!getRequestValue("port", port, jRequestParams, true, jResponse))
+            return;
+
+        std::string error;
+        if (Farm::f().addSqrlDevice(host, port, error))
+        {
+            jResponse["result"] = true;
+        }
+        else
+        {
+            jResponse["error"]["code"] = -422;
+            jResponse["error"]["message"] = error;
+            return;
+        }
+    }
+
+    else if (_method == "miner_removedevice")
+    {
+        if (!checkApiWriteAccess(m_readonly, jResponse))
+            return;
+
+        Json::Value jRequestParams;
+        if (!getRequestValue("params", jRequestParams, jRequest, false, jResponse))
+            return;
+
+        unsigned index;
+        if (!getRequestValue("index", index, jRequestParams, false, jResponse))
+            return;
+
+        if (Farm::f().removeMiner(index))
+        {
+            jResponse["result"] = true;
+        }
+        else
+        {
+            jResponse["error"]["code"] = -422;
+            jResponse["error"]["message"] = "Index out of bounds";
+            return;
+        }
+    }
+
     else if (_method == "miner_setverbosity")
     {
         if (!checkApiWriteAccess(m_readonly, jResponse))
@@ -980,23 +1035,17 @@ Json::Value ApiConnection::getMinerStat1()
     poolAddresses << connection->Host() << ':' << connection->Port();
     invalidStats << ";0;0";  // DualMining not supported
 
-    int gpuIndex;
-    int numGpus = t.miners.size();
-
-    for (gpuIndex = 0; gpuIndex < numGpus; gpuIndex++)
-    {
-        detailedMhEth << std::fixed << std::setprecision(0)
-                      << t.miners.at(gpuIndex).hashrate / 1000.0f
-                      << (((numGpus - 1) > gpuIndex) ? ";" : "");
-        detailedMhDcr << "off"
-                      << (((numGpus - 1) > gpuIndex) ? ";" : "");  // DualMining not supported
-    }
-
-    for (gpuIndex = 0; gpuIndex < numGpus; gpuIndex++)
+    // Devices removed at runtime keep their telemetry slot, leave them out
+    const char* sep = "";
+    for (auto const& miner : t.miners)
     {
-        tempAndFans << t.miners.at(gpuIndex).sensors.tempC << ";"
-                    << t.miners.at(gpuIndex).sensors.fanP
-                    << (((numGpus - 1) > gpuIndex) ? ";" : "");  // Fetching Temp and Fans
+        if (miner.removed)
+            continue;
+        detailedMhEth << sep << std::fixed << std::setprecision(0) << miner.hashrate / 1000.0f;
+        detailedMhDcr << sep << "off";  // DualMining not supported
+        tempAndFans << sep << miner.sensors.tempC << ";"
+                    << miner.sensors.fanP;  // Fetching Temp and Fans
+        sep = ";";
     }
 
     Json::Value jRes;
@@ -1053,6 +1102,17 @@ Json::Value ApiConnection::getMinerStatDetailPerMiner(
 
     hwinfo["sensors"] = sensors;
 
+    if (_t.miners.at(_index).sensors.clockMHz)
+        hwinfo["clock"] = _t.miners.at(_index).sensors.clockMHz;
+    if (_t.miners.at(_index).sensors.voltage)
+        hwinfo["voltage"] = _t.miners.at(_index).sensors.voltage;
+    if (_t.miners.at(_index).efficiency())
+        hwinfo["efficiency"] = _t.miners.at(_index).efficiency();
+
+    float busOps = _miner->getBusOpsRate();
+    if (busOps > 0)
+        hwinfo["bus_ops"] = (unsigned)busOps;
+
     /* Mining Info */
     Json::Value mininginfo;
     Json::Value jshares = Json::Value(Json::arrayValue);
@@ -1070,6 +1130,14 @@ Json::Value ApiConnection::getMinerStatDetailPerMiner(
     mininginfo["paused"] = _miner->paused();
     mininginfo["pause_reason"] = _miner->paused() ? _miner->pausedString() : Json::Value::null;
 
+    /* Scheduled DAG load infos */
+    DagLoadState dagState = _miner->getDagLoadState();
+    if (dagState != DagLoadState::Idle)
+    {
+        mininginfo["dag_state"] = (dagState == DagLoadState::Queued ? "queued" : "loading");
+        mininginfo["dag_eta"] = _miner->getDagLoadEta();
+    }
+
     /* Nonce infos */
     auto segment_width = Farm::f().get_segment_width();
     uint64_t gpustartnonce = Farm::f().get_nonce_scrambler() + ((uint64_t)_index << segment_width);
@@ -1080,6 +1148,25 @@ Json::Value ApiConnection::getMinerStatDetailPerMiner(
     /* Hash & Share infos */
     mininginfo["hashrate"] = toHex((uint32_t)_t.miners.at(_index).hashrate, HexPrefix::Add);
 
+    /* Hashrate statistics */
+    Json::Value jstats;
+    HashRateStats const& stats = _miner->hashRateStats();
+    for (int w = 0; w < HashRateStats::WindowCount; w++)
+    {
+        HashRateWindow window = stats.window((HashRateStats::Window)w);
+        Json::Value jwindow;
+        jwindow["mean"] = (uint64_t)window.mean;
+        jwindow["min"] = (uint64_t)window.min;
+        jwindow["max"] = (uint64_t)window.max;
+        jwindow["p5"] = (uint64_t)window.p5;
+        jwindow["p50"] = (uint64_t)window.p50;
+        jwindow["p95"] = (uint64_t)window.p95;
+        jwindow["samples"] = (unsigned)window.samples;
+        jstats[HashRateStats::windowName((HashRateStats::Window)w)] = jwindow;
+    }
+    jstats["ewma"] = (uint64_t)stats.ewma();
+    mininginfo["hashrate_stats"] = jstats;
+
     jRes["hardware"] = hwinfo;
     jRes["mining"] = mininginfo;
 
@@ -1239,6 +1326,11 @@ Json::Value ApiConnection::getMinerStatDetail()
     mininginfo["epoch"] = PoolManager::p().getCurrentEpoch();
     mininginfo["epoch_changes"] = PoolManager::p().getEpochChanges();
     mininginfo["difficulty"] = PoolManager::p().getCurrentDifficulty();
+    if (t.farm.sensors.powerW > 0)
+    {
+        mininginfo["power"] = t.farm.sensors.powerW;
+        mininginfo["efficiency"] = t.farm.efficiency();
+    }
 
     sharesinfo.append(t.farm.solutions.accepted);
     sharesinfo.append(t.farm.solutions.rejected);
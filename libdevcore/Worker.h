@@ -64,6 +64,9 @@ public:
     /// Whether or not this worker should stop
     bool shouldStop() const { return m_state != WorkerState::Started; }
 
+    /// Whether the work loop has returned and the thread is idle
+    bool isStopped() const { return m_state == WorkerState::Stopped; }
+
 private:
     virtual void workLoop() = 0;
 
@@ -403,7 +403,7 @@ void CLMiner::workLoop()
                         memcpy(mix.data(), (char*)results.rslt[i].mix, sizeof(results.rslt[i].mix));
 
                         Farm::f().submitProof(Solution{
-                            nonce, mix, current, std::chrono::steady_clock::now(), m_index});
+                            nonce, mix, current, std::chrono::steady_clock::now(), m_index, h256()});
                         cllog << EthWhite << "Job: " << current.header.abridged() << " Sol: 0x"
                               << toHex(nonce) << EthReset;
                     }
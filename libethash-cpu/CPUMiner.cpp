@@ -282,7 +282,7 @@ void CPUMiner::search(const dev::eth::WorkPackage& w)
         if (r.solution_found)
         {
             h256 mix{reinterpret_cast<byte*>(r.mix_hash.bytes), h256::ConstructFromPointer};
-            auto sol = Solution{r.nonce, mix, w, std::chrono::steady_clock::now(), m_index};
+            auto sol = Solution{r.nonce, mix, w, std::chrono::steady_clock::now(), m_index, h256()};
 
             cpulog << EthWhite << "Job: " << w.header.abridged()
                    << " Sol: " << toHex(sol.nonce, HexPrefix::Add) << EthReset;
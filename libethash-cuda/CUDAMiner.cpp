@@ -394,7 +394,7 @@ void CUDAMiner::search(
                     uint64_t nonce = nonce_base + gids[i];
 
                     Farm::f().submitProof(
-                        Solution{nonce, mixes[i], w, std::chrono::steady_clock::now(), m_index});
+                        Solution{nonce, mixes[i], w, std::chrono::steady_clock::now(), m_index, h256()});
                     cudalog << EthWhite << "Job: " << w.header.abridged() << " Sol: 0x"
                             << toHex(nonce) << EthReset;
                 }
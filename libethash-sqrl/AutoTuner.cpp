@@ -1,4 +1,5 @@
 #include "AutoTuner.h"
+#include <libethcore/Farm.h>
 
 using namespace std;
 using namespace dev;
@@ -7,10 +8,13 @@ using namespace eth;
 
 #define sqrllog clog(SQRLChannel)
 
-AutoTuner::AutoTuner(SQRLMiner* minerInstance, TelemetryType* telemetry)
+// Stage 4 - VCCINT step, and what goes back on top of the best stable voltage
+static const unsigned stage4StepMV = 10;
+static const unsigned stage4MarginMV = 20;
+
+AutoTuner::AutoTuner(SQRLMiner* minerInstance)
 {
     _minerInstance = minerInstance;
-    _telemetry = telemetry;
     _settings = _minerInstance->getSQsettigns();
     _minerIndex = _minerInstance->getMinerIndex();
 }
@@ -18,13 +22,39 @@ AutoTuner::AutoTuner(SQRLMiner* minerInstance, TelemetryType* telemetry)
 void AutoTuner::startTune(double clk) {
     _lastTuneTime = std::chrono::steady_clock::now();
     _lastClock = clk;
+    if (_candidateActive)
+        clearSolutionStats();  // The DAG load is no part of the measurement
+    auto steps = _minerInstance->getClockSteps();
+    if (!steps.empty())
+        _freqSteps = steps;
+}
+
+/*
+ * Index of the ladder step closest to clk
+ */
+unsigned AutoTuner::findStep(double clk)
+{
+    unsigned best = 0;
+    for (unsigned i = 1; i < _freqSteps.size(); i++)
+        if (fabs(_freqSteps[i] - clk) < fabs(_freqSteps[best] - clk))
+            best = i;
+    return best;
+}
+
+/*
+ * Programs a ladder step exactly, _lastClock follows what was achieved
+ */
+void AutoTuner::stepClock(unsigned index)
+{
+    _lastClock = _minerInstance->setClock(_freqSteps[index], true);
 }
 
 void AutoTuner::tune(uint64_t newTcks)
 {
-    auto it = std::find(_freqSteps.begin(), _freqSteps.end(), _lastClock);
-    auto currentStepIndex = std::distance(_freqSteps.begin(), it);
-    if (!temperatureSafetyCheck(currentStepIndex))
+    unsigned currentStepIndex = findStep(_lastClock);
+    updateErrorStats();
+    // A strategy search rules out candidates running too hot itself
+    if (_settings->tuneStrategy == 0 && !temperatureSafetyCheck(currentStepIndex))
         return;
 
 
@@ -43,22 +73,43 @@ void AutoTuner::tune(uint64_t newTcks)
 
     bool tuningFinished = false;
 
-    if (_settings->autoTune >= 1)  // Stage 1: Do a quick tune to get max frequency
-        tuneStage1(elapsedSeconds, currentStepIndex, it, mhs);
-
-    if (_settings->autoTune >= 2)  // Stage 2: Check for long term stability and error rate (removes
-                                   // marginally stable)
+    if (_settings->tuneStrategy != 0)  // Searched by a strategy instead of the stages
     {
-        if (tuneStage2(currentStepIndex))
-            if (_settings->autoTune == 2)
+        bool searched = tuneWithStrategy(elapsedSeconds);
+        if (_settings->autoTune >= 4)  // Stage 4 follows the search
+        {
+            if (_intensityTuneFinished && !_tuneFinished && tuneStage4(elapsedSeconds))
                 tuningFinished = true;
+        }
+        else
+            tuningFinished = searched;
     }
-
-    if (_settings->autoTune >= 3)  // Stage 3: Tune N and P for given D.
+    else
     {
-        if (tuneStage3(elapsedSeconds))
-            if (_settings->autoTune == 3)
+        if (_settings->autoTune >= 1)  // Stage 1: Do a quick tune to get max frequency
+            tuneStage1(elapsedSeconds, currentStepIndex, mhs);
+
+        if (_settings->autoTune >= 2)  // Stage 2: Check for long term stability and error rate
+                                       // (removes marginally stable)
+        {
+            if (tuneStage2(currentStepIndex))
+                if (_settings->autoTune == 2)
+                    tuningFinished = true;
+        }
+
+        if (_settings->autoTune >= 3)  // Stage 3: Tune N and P for given D.
+        {
+            if (tuneStage3(elapsedSeconds))
+                if (_settings->autoTune == 3)
+                    tuningFinished = true;
+        }
+
+        if (_settings->autoTune >= 4 && _intensityTuneFinished)  // Stage 4: Lower VCCINT for
+                                                                 // hashes per joule
+        {
+            if (tuneStage4(elapsedSeconds))
                 tuningFinished = true;
+        }
     }
 
 
@@ -76,10 +127,133 @@ void AutoTuner::tune(uint64_t newTcks)
                 break;
         }
         _tuningStage = 0;
+        _tuneFinished = true;
+    }
+}
+
+/*
+ * True while the tuner still changes clock or intensity
+ */
+bool AutoTuner::isTuning()
+{
+    if (_settings->autoTune == 0 ||
+        std::find(_settings->tuneExclude.begin(), _settings->tuneExclude.end(), _minerIndex) !=
+            _settings->tuneExclude.end())
+        return false;
+    if (_settings->autoTune == 1 && _settings->tuneStrategy == 0)
+        return !_stableFreqFound;
+    return !_tuneFinished;
+}
+
+/*
+ * One step of a --tune-strategy search, true once it found settings to keep.
+ * Every candidate runs for the time the strategy asks, scored by the same
+ * error penalized hashrate as stage 3. It is ruled out if it gets too hot,
+ * crashes, surely errs more than 3%, or hashes under 90% of what clock and
+ * throughput should give, as stage 1 judges stability
+ */
+bool AutoTuner::tuneWithStrategy(uint64_t elapsedSeconds)
+{
+    if (_tuneFinished || _intensityTuneFinished)
+        return false;
+
+    float errorRateThreshold = 0.03;  // 3%
+    if (!_strategy)
+    {
+        TuneSpace space;
+        for (double clk : _freqSteps)
+            if (clk > 0 && clk <= _settings->tuneMaxClk)
+                space.clocks.push_back(clk);
+        space.start.clock = _lastClock;
+        space.start.patience = _settings->patience;
+        space.start.intensityN = _settings->intensityN;
+        space.start.intensityD = _settings->intensityD;
+        space.tuneIntensity = _settings->autoTune >= 3;
+        space.seconds = std::max(30u, _settings->tuneTime / 2);
+        space.seed = _minerIndex;
+        _strategy = TuneStrategy::create((TuneStrategyType)_settings->tuneStrategy, space);
+        _strategyStart = space.start;
+        if (!_strategy)
+        {
+            sqrllog << EthRed << "Unknown tune strategy " << _settings->tuneStrategy;
+            _tuneFinished = true;
+            return false;
+        }
+        sqrllog << EthOrange << "Tuning by " << _strategy->name() << " over "
+                << space.clocks.size() << " clock steps"
+                << (space.tuneIntensity ? ", intensity and patience" : "");
+    }
+    _tuningStage = 1;
+
+    if (_candidateActive)
+    {
+        uint8_t* FPGAtemps = _minerInstance->getFPGAtemps();
+        bool tooHot = FPGAtemps[0] >= _settings->tuneMaxCoreTemp ||
+                      FPGAtemps[1] >= _settings->tuneMaxHBMtemp ||
+                      FPGAtemps[2] >= _settings->tuneMaxHBMtemp;
+        if (!tooHot && elapsedSeconds < _candidateSeconds)
+            return false;
+
+        TuneCandidate& c = _candidate;
+        c.hashrate = _tuneHashCounter / std::max(elapsedSeconds, (uint64_t)1);
+        c.errorRate = _errors.rate();
+        c.score = c.hashrate * (1 - c.errorRate);
+        string verdict;
+        if (tooHot)
+            verdict = "too hot";
+        else if (_minerInstance->getClock() < 100)
+            verdict = "FPGA crashed";
+        else if (_errors.lower() > errorRateThreshold)
+            verdict = "error rate above threshold";
+        else if (c.hashrate < c.modelHashrate() * .9)
+            verdict = "unstable";
+        if (!verdict.empty())
+            c.score = -1;
+        sqrllog << EthOrange << "T: [" << c.to_string() << "] errorRate=" << c.errorRate * 100
+                << "% Hashrate=" << c.hashrate / pow(10, 6) << "MHs"
+                << (verdict.empty() ? "" : " - " + verdict);
+        _strategy->report(c);
+        _candidateActive = false;
+    }
+
+    if (_strategy->next(_candidate, _candidateSeconds))
+    {
+        stepClock(findStep(_candidate.clock));
+        _intensitySettings.patience = _candidate.patience;
+        _intensitySettings.intensityN = _candidate.intensityN;
+        _intensitySettings.intensityD = _candidate.intensityD;
+        sqrllog << EthOrange << "T: " << _strategy->progress() << ", trying "
+                << _candidate.to_string();
+        clearSolutionStats();
+        _lastTuneTime = std::chrono::steady_clock::now();
+        _candidateActive = true;
+        return false;
+    }
+
+    TuneCandidate best = _strategy->best();
+    if (best.score < 0)
+    {
+        sqrllog << EthRed << "T: No candidate held up, back to " << _strategyStart.to_string();
+        best = _strategyStart;
+    }
+    stepClock(findStep(best.clock));
+    _intensitySettings.patience = best.patience;
+    _intensitySettings.intensityN = best.intensityN;
+    _intensitySettings.intensityD = best.intensityD;
+    _bestSettingsSoFar = std::make_pair(_intensitySettings, best.score);
+    _stableFreqFound = true;
+    _intensityTuneFinished = true;
+    if (best.score < 0)  // Nothing measured to keep for the next run
+    {
+        _tuningStage = 0;
+        _tuneFinished = true;
+        return false;
     }
+    sqrllog << EthOrange << "T: Best ->" << best.to_string() << " with hashrate="
+            << best.hashrate / pow(10, 6) << "MHs, error rate " << best.errorRate * 100 << "%";
+    return true;
 }
-void AutoTuner::tuneStage1(
-    uint64_t elapsedSeconds, unsigned currentStepIndex, vector<unsigned>::iterator it, float mhs)
+void AutoTuner::tuneStage1(uint64_t elapsedSeconds, unsigned currentStepIndex, float mhs)
 {
     if (_stableFreqFound)  // nothing to do...
         return;
@@ -93,9 +267,9 @@ void AutoTuner::tuneStage1(
 
     if (elapsedSeconds > stage1_averageSeconds)
     {
-        if (it == _freqSteps.end())
+        if (_freqSteps.empty())
         {
-            sqrllog << EthOrange << "S1: Could not find starting index, stopping...";
+            sqrllog << EthOrange << "S1: No frequency steps available, stopping...";
             return;
         }
 
@@ -104,14 +278,12 @@ void AutoTuner::tuneStage1(
             if (!_maxFreqReached)
             {
                 if (currentStepIndex != _freqSteps.size() - 1 &&
-                    _freqSteps[currentStepIndex] != _settings->tuneMaxClk)  // not getting out of
-                                                                            // bounds
+                    _freqSteps[currentStepIndex + 1] <= _settings->tuneMaxClk)  // not getting out
+                                                                                // of bounds
                 {
-                    int nextClock = _freqSteps[currentStepIndex + 1] + 1;  //+1 for precision issues
                     sqrllog << EthOrange << "S1: Stable at " << _lastClock << "MHz, trying "
-                            << nextClock - 1 << "...";
-                    _minerInstance->setClock(nextClock);
-                    _lastClock = nextClock - 1;
+                            << _freqSteps[currentStepIndex + 1] << "...";
+                    stepClock(currentStepIndex + 1);
                 }
                 else
                 {
@@ -125,11 +297,9 @@ void AutoTuner::tuneStage1(
             _maxFreqReached = true;
             if (currentStepIndex > 0)
             {
-                int nextClock = _freqSteps[currentStepIndex - 1] + 1;  //+1 for precision issues
                 sqrllog << EthOrange << "S1: Unstable at " << _lastClock << "MHz, downclocking to "
-                        << nextClock - 1 << "...";
-                _minerInstance->setClock(nextClock);
-                _lastClock = nextClock - 1;
+                        << _freqSteps[currentStepIndex - 1] << "...";
+                stepClock(currentStepIndex - 1);
 
                 clearSolutionStats();
             }
@@ -145,35 +315,39 @@ bool AutoTuner::tuneStage2(unsigned currentStepIndex)
 {
     // Stage 2:
     float errorRateThreshold = 0.03;  // 3%
-    int tuningShareCount = _settings->tuneTime;  // how many low shares to check to derive average from
+    // Undecided after this many shares - the rate is close enough to the threshold to go by it
+    unsigned maxShareCount = _settings->tuneTime * 10;
 
     if (_maxFreqReached && !_stableFreqFound)
     {
-        // calculate error rate
-        auto solutions = _telemetry->miners.at(_minerIndex).solutions;
-
-        if (solutions.low > 0 && (solutions.low + solutions.failed) % tuningShareCount == 0)
+        // Decide once the confidence interval is clear of the threshold
+        bool unstable = _errors.lower() > errorRateThreshold;
+        bool stable = _errors.upper() < errorRateThreshold;
+        if (!unstable && !stable && _errors.samples() >= maxShareCount)
         {
-            float errorRate = getHardwareErrorRate();
+            unstable = _errors.rate() > errorRateThreshold;
+            stable = !unstable;
+        }
 
-            if (errorRate > errorRateThreshold)
-            {
-                sqrllog << EthOrange << "S2: Error rate of " << errorRate * 100
-                        << "% above threshold (" << errorRateThreshold * 100
-                        << "%), downclocking...";
-                int nextClock = _freqSteps[currentStepIndex - 1] + 1;  //+1 for precision issues
-                _minerInstance->setClock(nextClock);
-                _lastClock = nextClock - 1;
+        if (unstable)
+        {
+            sqrllog << EthOrange << "S2: Error rate of " << _errors.rate() * 100 << "% ["
+                    << _errors.lower() * 100 << "-" << _errors.upper() * 100 << "%] over "
+                    << _errors.samples() << " shares above threshold ("
+                    << errorRateThreshold * 100 << "%), downclocking...";
+            if (currentStepIndex > 0)
+                stepClock(currentStepIndex - 1);
 
-                clearSolutionStats();
-            }
-            else
-            {
-                sqrllog << EthOrange << "S2: Stable long term frequency found at " << _lastClock
-                        << "MHz";
-                _stableFreqFound = true;
-                return true;
-            }
+            clearSolutionStats();
+        }
+        else if (stable)
+        {
+            sqrllog << EthOrange << "S2: Stable long term frequency found at " << _lastClock
+                    << "MHz, error rate " << _errors.rate() * 100 << "% [" << _errors.lower() * 100
+                    << "-" << _errors.upper() * 100 << "%] over " << _errors.samples()
+                    << " shares";
+            _stableFreqFound = true;
+            return true;
         }
         _tuningStage = 2;
     }
@@ -350,6 +524,158 @@ bool AutoTuner::tuneStage3(uint64_t elapsedSeconds)
     return false;
 }
 
+/*
+ * Stage 4: At the clock and intensity stage 3 (or the strategy) settled on,
+ * VCCINT comes down a step at a time. Each step runs for the tune time, longer
+ * if its error rate is still undecided, and counts as stable as stage 2 judges
+ * it, with the hashrate held within 90% of the model as in stage 1. The first
+ * step that fails - or gets too hot, or crashes the FPGA - ends the search.
+ * The stable voltage with the most hashes per joule wins, with a safety
+ * margin on top, as efficiency rather than raw hashrate is what this buys.
+ * Without a power reading the model power is scaled by V^2, so the lowest
+ * stable voltage wins
+ */
+bool AutoTuner::tuneStage4(uint64_t elapsedSeconds)
+{
+    if (_voltageTuneFinished)  // nothing to do, finished...
+        return false;
+
+    float errorRateThreshold = 0.03;  // 3%
+    unsigned maxShareCount = _settings->tuneTime * 10;
+    _tuningStage = 4;
+
+    if (!_voltageTuning)
+    {
+        _minerInstance->readVoltage(_startFkVCCINT, _startJcVCCINT);
+        if (_startFkVCCINT == 0 && _startJcVCCINT == 0)
+        {
+            sqrllog << EthOrange << "S4: No VCCINT regulator answering, voltage left alone";
+            _voltageTuneFinished = true;
+            return true;
+        }
+        sqrllog << EthOrange << "S4: Lowering VCCINT from"
+                << (_startFkVCCINT ? " FK " + to_string(_startFkVCCINT) + "mV" : "")
+                << (_startJcVCCINT ? " JC " + to_string(_startJcVCCINT) + "mV" : "")
+                << " at " << _lastClock << "MHz " << _intensitySettings.to_string();
+        _voltageTuning = true;
+        _voltageOffset = 0;
+        _voltageResults.clear();
+        _tunedFkVout = 0;
+        _tunedJcVout = 0;
+        clearSolutionStats();
+        _lastTuneTime = std::chrono::steady_clock::now();
+        return false;
+    }
+
+    uint8_t* FPGAtemps = _minerInstance->getFPGAtemps();
+    bool tooHot = FPGAtemps[0] >= _settings->tuneMaxCoreTemp ||
+                  FPGAtemps[1] >= _settings->tuneMaxHBMtemp ||
+                  FPGAtemps[2] >= _settings->tuneMaxHBMtemp;
+    bool crashed = _minerInstance->getClock() < 100;
+    if (!tooHot && !crashed && elapsedSeconds < _settings->tuneTime)
+        return false;
+
+    bool unstable = _errors.lower() > errorRateThreshold;
+    bool stable = _errors.upper() < errorRateThreshold;
+    if (!unstable && !stable && !tooHot && !crashed)
+    {
+        if (_errors.samples() < maxShareCount && elapsedSeconds < _settings->tuneTime * 4)
+            return false;  // Not decided yet
+        unstable = _errors.rate() > errorRateThreshold;
+    }
+
+    double hashrate = _tuneHashCounter / std::max(elapsedSeconds, (uint64_t)1);
+    IntensitySettings intensity =
+        _intensitySettings.isSet() ? _intensitySettings : _bestSettingsSoFar.first;
+    double throughput =
+        intensity.isSet() ?
+            (double)intensity.intensityN / (intensity.intensityN + intensity.intensityD) :
+            _minerInstance->getThroughput();
+    double model = _lastClock / 8 * throughput * 1e6;
+
+    string verdict;
+    if (tooHot)
+        verdict = "too hot";
+    else if (crashed)
+        verdict = "FPGA crashed";
+    else if (unstable)
+        verdict = "error rate above threshold";
+    else if (hashrate < model * .9)
+        verdict = "unstable";
+
+    unsigned fk = _startFkVCCINT ? _startFkVCCINT - _voltageOffset : 0;
+    unsigned jc = _startJcVCCINT ? _startJcVCCINT - _voltageOffset : 0;
+    string volts = (fk ? " FK " + to_string(fk) + "mV" : string()) +
+                   (jc ? " JC " + to_string(jc) + "mV" : string());
+
+    if (verdict.empty())
+    {
+        double power = _minerInstance->boardPower();
+        if (!_minerInstance->powerMeasured())
+        {
+            double v = (double)(fk ? fk : jc) / (fk ? _startFkVCCINT : _startJcVCCINT);
+            power *= v * v;
+        }
+        double efficiency = hashrate * (1 - _errors.rate()) / std::max(power, 1.0);
+        _voltageResults.push_back(std::make_pair(_voltageOffset, efficiency));
+        sqrllog << EthOrange << "S4:" << volts << " stable, error rate " << _errors.rate() * 100
+                << "% Hashrate=" << hashrate / pow(10, 6) << "MHs "
+                << efficiency / pow(10, 6) << "MH/J"
+                << (_minerInstance->powerMeasured() ? "" : " (modelled)");
+
+        unsigned lowest = std::min(_startFkVCCINT ? _startFkVCCINT : UINT_MAX,
+            _startJcVCCINT ? _startJcVCCINT : UINT_MAX);
+        if (lowest >= _voltageOffset + stage4StepMV + _settings->tuneMinVCCINT)
+        {
+            applyVoltageOffset(_voltageOffset + stage4StepMV);
+            clearSolutionStats();
+            _lastTuneTime = std::chrono::steady_clock::now();
+            return false;
+        }
+        sqrllog << EthOrange << "S4: Reached the " << _settings->tuneMinVCCINT << "mV floor";
+    }
+    else
+    {
+        sqrllog << EthOrange << "S4:" << volts << " - " << verdict << ", error rate "
+                << _errors.rate() * 100 << "% Hashrate=" << hashrate / pow(10, 6) << "MHs";
+    }
+
+    // Most hashes per joule, the lower voltage on a tie, then back up by the margin
+    unsigned settled = 0;
+    double bestEfficiency = -1;
+    for (auto const& r : _voltageResults)
+        if (r.second >= bestEfficiency)
+        {
+            settled = r.first;
+            bestEfficiency = r.second;
+        }
+    settled = settled > stage4MarginMV ? settled - stage4MarginMV : 0;
+    applyVoltageOffset(settled);
+    if (crashed)
+        stepClock(findStep(_lastClock));  // Relock at the settled voltage
+
+    _tunedFkVout = _startFkVCCINT ? _startFkVCCINT - settled : 0;
+    _tunedJcVout = _startJcVCCINT ? _startJcVCCINT - settled : 0;
+    sqrllog << EthOrange << "S4: Settled on"
+            << (_tunedFkVout ? " FK " + to_string(_tunedFkVout) + "mV" : "")
+            << (_tunedJcVout ? " JC " + to_string(_tunedJcVout) + "mV" : "") << ", "
+            << settled << "mV below the start";
+    _voltageTuning = false;
+    _voltageTuneFinished = true;
+    clearSolutionStats();
+    return true;
+}
+
+/*
+ * Programs the regulators that answered offset mV below where stage 4 started
+ */
+void AutoTuner::applyVoltageOffset(unsigned offset)
+{
+    _voltageOffset = offset;
+    _minerInstance->setVoltage(_startFkVCCINT ? _startFkVCCINT - offset : 0,
+        _startJcVCCINT ? _startJcVCCINT - offset : 0);
+}
+
 int AutoTuner::findBestIntensitySoFar()
 {
     int bestIndex = 0;
@@ -366,17 +692,48 @@ int AutoTuner::findBestIntensitySoFar()
     return bestIndex;
 }
 
+/*
+ * Starts a new measurement period. Farm telemetry is left alone, only the
+ * tuner's own error rate estimate starts over
+ */
 void AutoTuner::clearSolutionStats()
 {
-    _telemetry->miners.at(_minerIndex).solutions.accepted = 0;
-    _telemetry->miners.at(_minerIndex).solutions.failed = 0;
-    _telemetry->miners.at(_minerIndex).solutions.low = 0;
-    _telemetry->miners.at(_minerIndex).solutions.rejected = 0;
-    _telemetry->miners.at(_minerIndex).solutions.wasted = 0;
-
+    _errors.restart();
     _tuneHashCounter = 0;
 }
 
+/*
+ * Feeds the share outcomes verified since the last call into the estimator
+ */
+void AutoTuner::updateErrorStats()
+{
+    auto solutions = Farm::f().getSolutions(_minerIndex);
+    unsigned good = solutions.accepted + solutions.low;
+
+    // Counters only go down if someone else reset them
+    if (solutions.failed < _lastFailed || good < _lastGood)
+    {
+        _lastFailed = solutions.failed;
+        _lastGood = good;
+        return;
+    }
+
+    _errors.add(solutions.failed - _lastFailed, good - _lastGood);
+    _lastFailed = solutions.failed;
+    _lastGood = good;
+}
+
+/*
+ * Next frequency step below clk, 0 if there is none
+ */
+double AutoTuner::getLowerClockStep(double clk)
+{
+    for (auto it = _freqSteps.rbegin(); it != _freqSteps.rend(); ++it)
+        if (*it != 0 && *it < clk)
+            return *it;
+    return 0;
+}
+
 bool AutoTuner::readSavedTunes(string fileName, string settingID)
 {
     // if FPGA is excluded from tuning - don't bother
@@ -403,12 +760,18 @@ bool AutoTuner::readSavedTunes(string fileName, string settingID)
                     _settings->patience = stoi(words[2]);
                     _settings->intensityN = stoi(words[3]);
                     _settings->intensityD = stoi(words[4]);
+                    _tunedFkVout = words.size() >= 7 ? stoi(words[5]) : 0;
+                    _tunedJcVout = words.size() >= 7 ? stoi(words[6]) : 0;
                     tuneFound = true;
                 }
             }
         }
         if (tuneFound)
+        {
+            if (_tunedFkVout || _tunedJcVout)
+                _minerInstance->setVoltage(_tunedFkVout, _tunedJcVout);
             return true;
+        }
     }
     catch (const exception& e)
     {
@@ -418,18 +781,52 @@ bool AutoTuner::readSavedTunes(string fileName, string settingID)
     return false;
 }
 
+/*
+ * Applies the tune recorded in the device state store, the caller has checked
+ * it was made at the current voltages
+ */
+bool AutoTuner::applySavedState(const SQRLDeviceState& state)
+{
+    // if FPGA is excluded from tuning - don't bother
+    if (std::find(_settings->tuneExclude.begin(), _settings->tuneExclude.end(), _minerIndex) !=
+        _settings->tuneExclude.end())
+        return false;
+    if (state.tunedClock <= 0 || state.tunedPatience == 0 || state.tunedIntensityN == 0 ||
+        state.tunedIntensityD == 0)
+        return false;
+
+    sqrllog << "Found a previous tune in the state store!";
+    _lastClock = state.tunedClock;
+    _minerInstance->setLastClock(_lastClock + 1);  // for precision issues
+    _settings->patience = state.tunedPatience;
+    _settings->intensityN = state.tunedIntensityN;
+    _settings->intensityD = state.tunedIntensityD;
+    _tunedFkVout = state.tunedFkVout;
+    _tunedJcVout = state.tunedJcVout;
+    if (_tunedFkVout || _tunedJcVout)  // Stage 4 ran, VCCINT goes where it settled
+        _minerInstance->setVoltage(_tunedFkVout, _tunedJcVout);
+    return true;
+}
+
 bool AutoTuner::saveTune()
 {
+    _minerInstance->saveTunedState(_lastClock, _bestSettingsSoFar.first.patience,
+        _bestSettingsSoFar.first.intensityN, _bestSettingsSoFar.first.intensityD, _tunedFkVout,
+        _tunedJcVout);
+
     ofstream ofs;
-    ofs.open("tune.txt", std::ios_base::app);  // append instead of overwrite
+    ofs.open(_settings->tuneFile, std::ios_base::app);  // append instead of overwrite
     if (ofs.is_open())
     {
-        sqrllog << EthOrange << "Tune finished, saving tune.txt!";
-        ofs << _minerInstance->getSettingsID() << "," << _lastClock << ","
+        sqrllog << EthOrange << "Tune finished, saving " << _settings->tuneFile << "!";
+        ofs << _minerInstance->getSettingsID() << "," << (int)_lastClock << ","
             << _bestSettingsSoFar.first.patience << ","
-            << _bestSettingsSoFar.first.intensityN << "," << _bestSettingsSoFar.first.intensityD
-            << endl;
+            << _bestSettingsSoFar.first.intensityN << "," << _bestSettingsSoFar.first.intensityD;
+        if (_tunedFkVout || _tunedJcVout)  // Stage 4 - older readers ignore the extra columns
+            ofs << "," << _tunedFkVout << "," << _tunedJcVout;
+        ofs << endl;
         ofs.close();
+        _minerInstance->saveDeviceState();
         return true;
     }
     else
@@ -471,9 +868,7 @@ bool AutoTuner::temperatureSafetyCheck(unsigned currentStepIndex)
 
             if (currentStepIndex > 0)
             {
-                int nextClock = _freqSteps[currentStepIndex - 1] + 1;  //+1 for precision issues
-                _minerInstance->setClock(nextClock);
-                _lastClock = nextClock - 1;
+                stepClock(currentStepIndex - 1);
             }
             else
             {
@@ -487,6 +882,13 @@ bool AutoTuner::temperatureSafetyCheck(unsigned currentStepIndex)
             _intensityTuning = false;
             _bestIntensityRangeFound = false;
             _intensityTuneFinished = false;
+            _tuneFinished = false;
+            if (_voltageTuning)  // Back to where stage 4 started, it runs again
+            {
+                applyVoltageOffset(0);
+                _voltageTuning = false;
+            }
+            _voltageTuneFinished = false;
             clearSolutionStats();
             _tuningStage = 0;
         }
@@ -495,13 +897,10 @@ bool AutoTuner::temperatureSafetyCheck(unsigned currentStepIndex)
     }
     return true;
 }
+/*
+ * Error rate since the last measurement period started
+ */
 float AutoTuner::getHardwareErrorRate()
 {
-    auto sol = _telemetry->miners.at(_minerIndex).solutions;
-    int allSolutions = sol.accepted + sol.failed + sol.low;
-    int failedSolutions = sol.failed;
-    if (allSolutions == 0)
-        return 0;
-
-    return failedSolutions / (float)allSolutions;
+    return _errors.rate();
 }
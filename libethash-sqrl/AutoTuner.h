@@ -1,5 +1,8 @@
 #pragma once
 #include "SQRLMiner.h"
+#include "ErrorRateEstimator.h"
+#include "SQRLStateStore.h"
+#include "TuneStrategy.h"
 #include <fstream>
 
 namespace dev
@@ -31,10 +34,10 @@ class AutoTuner
 {
    private:
     SQRLMiner* _minerInstance = NULL;
-    TelemetryType* _telemetry = NULL;
     SQSettings* _settings = NULL;
     unsigned _minerIndex = 0;
-    vector<unsigned> _freqSteps = {0, 100, 200, 246, 252, 259, 266, 274, 282, 290, 300, 309, 320, 331,
+    // Replaced by the ladder the clock wizard can reach once the device reports it
+    vector<double> _freqSteps = {0, 100, 200, 246, 252, 259, 266, 274, 282, 290, 300, 309, 320, 331,
         342, 355, 369, 384, 400, 417, 436, 457, 480, 505, 533, 564, 600};
 
     vector<double> _throughputTargets = {0.6, 0.65, 0.7, 0.75, 0.8, 0.85, 0.9, 0.92};
@@ -42,6 +45,9 @@ class AutoTuner
     typedef std::chrono::steady_clock::time_point timePoint;
 
     double _tuneHashCounter = 0;
+    ErrorRateEstimator _errors;
+    unsigned _lastFailed = 0;
+    unsigned _lastGood = 0;
     timePoint _lastTuneTime = std::chrono::steady_clock::now();
     timePoint _tuneTempCheckTimer = std::chrono::steady_clock::now();
     
@@ -50,6 +56,7 @@ class AutoTuner
     bool _maxFreqReached = false;
     double _lastClock = 0;
     bool _intensityTuneFinished = false;
+    bool _tuneFinished = false;
     bool _intensityTuning = false;
     bool _bestIntensityRangeFound = false;
 
@@ -61,28 +68,55 @@ class AutoTuner
     IntensitySettings _intensitySettings;
     pair<IntensitySettings, double> _bestSettingsSoFar;
     vector<pair<IntensitySettings, double>> _shareTimes;  // how many target checks in set time
+
+    // Stage 4 - VCCINT stepped down at the stage 3 operating point, mV below the start
+    bool _voltageTuning = false;
+    bool _voltageTuneFinished = false;
+    unsigned _startFkVCCINT = 0;  // 0 if that regulator does not answer
+    unsigned _startJcVCCINT = 0;
+    unsigned _voltageOffset = 0;
+    vector<pair<unsigned, double>> _voltageResults;  // Stable offsets and their hashes per joule
+    unsigned _tunedFkVout = 0;  // What stage 4 settled on, 0 if it did not
+    unsigned _tunedJcVout = 0;
+
+    // Search by --tune-strategy instead of the staged tune
+    std::unique_ptr<TuneStrategy> _strategy;
+    TuneCandidate _strategyStart;
+    TuneCandidate _candidate;
+    unsigned _candidateSeconds = 0;
+    bool _candidateActive = false;
     
 
-    void tuneStage1(uint64_t elapsedSeconds, unsigned currentStepIndex, vector<unsigned>::iterator it, float mhs);
+    void tuneStage1(uint64_t elapsedSeconds, unsigned currentStepIndex, float mhs);
     bool tuneStage2(unsigned currentStepIndex);
     bool tuneStage3(uint64_t elapsedSeconds);
+    bool tuneStage4(uint64_t elapsedSeconds);
+    bool tuneWithStrategy(uint64_t elapsedSeconds);
+    void applyVoltageOffset(unsigned offset);
     int findBestIntensitySoFar();
+    unsigned findStep(double clk);
+    void stepClock(unsigned index);
     void clearSolutionStats();
+    void updateErrorStats();
     bool saveTune();
     bool temperatureSafetyCheck(unsigned currentStepIndex);
     
    
 
 public:
-    AutoTuner(SQRLMiner* minerInstance, TelemetryType* telemetry);
+    AutoTuner(SQRLMiner* minerInstance);
     ~AutoTuner(){};
     
 
     void startTune(double clk);
     void tune(uint64_t newTcks);
     bool readSavedTunes(string fileName, string settingID);
+    bool applySavedState(const SQRLDeviceState& state);
     float getHardwareErrorRate();
+    ErrorRateEstimator& getErrorEstimator() { return _errors; }
     uint8_t getTuningStage() { return _tuningStage; }
+    bool isTuning();
+    double getLowerClockStep(double clk);
     IntensitySettings getIntensitySettings() { return _intensitySettings; }
 };
 
@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "ErrorRateEstimator.h"
+
+using namespace std;
+using namespace dev;
+using namespace eth;
+
+/*
+ * Outcomes between two polls arrive as counts, their order is unknown -
+ * failures are spread evenly among the good shares
+ */
+void ErrorRateEstimator::add(unsigned failed, unsigned good)
+{
+    unsigned total = failed + good;
+    _failed += failed;
+    _total += total;
+
+    for (unsigned i = 0; i < total; i++)
+    {
+        bool isFailed = ((uint64_t)(i + 1) * failed / total) != ((uint64_t)i * failed / total);
+        _window.push_back(isFailed);
+        if (isFailed)
+            _windowFailed++;
+        if (_window.size() > _windowSize)
+        {
+            if (_window.front())
+                _windowFailed--;
+            _window.pop_front();
+        }
+    }
+}
+
+void ErrorRateEstimator::restart()
+{
+    _failed = 0;
+    _total = 0;
+}
+
+double ErrorRateEstimator::wilson(unsigned failed, unsigned total, double z, bool upperBound)
+{
+    if (total == 0)
+        return upperBound ? 1.0 : 0.0;
+
+    double n = total;
+    double p = failed / n;
+    double z2 = z * z;
+    double center = (p + z2 / (2 * n)) / (1 + z2 / n);
+    double half = (z * sqrt(p * (1 - p) / n + z2 / (4 * n * n))) / (1 + z2 / n);
+    return upperBound ? min(1.0, center + half) : max(0.0, center - half);
+}
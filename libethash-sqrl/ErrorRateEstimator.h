@@ -0,0 +1,56 @@
+#pragma once
+#include <deque>
+
+namespace dev
+{
+namespace eth
+{
+// Two sided 95% confidence
+#define SQRL_ERROR_RATE_Z 1.96
+
+/*
+ * Hardware error rate of a device from verified share outcomes, with Wilson
+ * score intervals. Keeps its own counts - telemetry is only ever read.
+ * Outcomes are tracked both over a sliding window of the latest shares and
+ * since the last restart(), which the tuner does for every setting it tries
+ */
+class ErrorRateEstimator
+{
+private:
+    std::deque<bool> _window;  // Latest outcomes, true = failed
+    size_t _windowSize;
+    unsigned _windowFailed = 0;
+
+    unsigned _failed = 0;  // Since restart
+    unsigned _total = 0;
+
+public:
+    explicit ErrorRateEstimator(size_t windowSize = 1000) : _windowSize(windowSize) {}
+
+    void add(unsigned failed, unsigned good);
+    void restart();
+
+    // Since restart
+    unsigned samples() { return _total; }
+    double rate() { return _total ? (double)_failed / _total : 0; }
+    double lower(double z = SQRL_ERROR_RATE_Z) { return wilson(_failed, _total, z, false); }
+    double upper(double z = SQRL_ERROR_RATE_Z) { return wilson(_failed, _total, z, true); }
+
+    // Over the sliding window
+    unsigned windowSamples() { return (unsigned)_window.size(); }
+    double windowRate() { return _window.empty() ? 0 : (double)_windowFailed / _window.size(); }
+    double windowLower(double z = SQRL_ERROR_RATE_Z)
+    {
+        return wilson(_windowFailed, (unsigned)_window.size(), z, false);
+    }
+    double windowUpper(double z = SQRL_ERROR_RATE_Z)
+    {
+        return wilson(_windowFailed, (unsigned)_window.size(), z, true);
+    }
+
+    static double wilson(unsigned failed, unsigned total, double z, bool upperBound);
+};
+
+
+}  // namespace eth
+}  // namespace dev
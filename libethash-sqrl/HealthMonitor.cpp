@@ -0,0 +1,195 @@
+#include "HealthMonitor.h"
+#include <libethcore/Farm.h>
+
+using namespace std;
+using namespace dev;
+using namespace eth;
+
+
+#define sqrllog clog(SQRLChannel)
+
+// Polls used to learn the rate baseline after start or an operating point change
+static const unsigned healthWarmupPolls = 30;
+// EWMA weight of the newest sample
+static const double healthEwmaAlpha = 0.1;
+// Rate CUSUM - drift (fraction of baseline) tolerated, and decision threshold.
+// A 10% drop trips after ~100 polls, a 50% drop after ~11
+static const double healthRateSlack = 0.05;
+static const double healthRateThreshold = 5.0;
+// Failed share CUSUM - the 3% error rate the tuner accepts plus 2% slack.
+// Trips after 4 consecutive failures or ~50 shares at 10%
+static const double healthFailedReference = 0.05;
+static const double healthFailedThreshold = 3.0;
+// Consecutive polls without target checks / with failed counter reads
+static const unsigned healthStallPolls = 3;
+static const unsigned healthLinkPolls = 3;
+
+HealthMonitor::HealthMonitor(SQRLMiner* minerInstance)
+{
+    _minerInstance = minerInstance;
+    _settings = _minerInstance->getSQsettigns();
+    _minerIndex = _minerInstance->getMinerIndex();
+}
+
+const char* HealthMonitor::eventName(HealthEvent event)
+{
+    switch (event)
+    {
+    case HealthEvent::Stall:
+        return "Stall";
+    case HealthEvent::Degradation:
+        return "Degradation";
+    case HealthEvent::HashErrors:
+        return "HashErrors";
+    case HealthEvent::Link:
+        return "Link";
+    default:
+        return "OK";
+    }
+}
+
+void HealthMonitor::restartBaseline()
+{
+    _warmupPolls = 0;
+    _baselineSum = 0;
+    _baseline = 0;
+    _rateCusum = 0;
+}
+
+/*
+ * Feeds one status poll. Returns the event detected, if any - it's reported
+ * once, detection restarts with acknowledge()
+ */
+HealthEvent HealthMonitor::update(
+    uint64_t newTChks, double elapsedSeconds, bool countersRead, double clk)
+{
+    if (_lastEvent != HealthEvent::None)
+        return HealthEvent::None;
+
+    // Link first - nothing below means anything without the counters
+    if (!countersRead)
+    {
+        if (++_readErrors >= healthLinkPolls)
+            _lastEvent = HealthEvent::Link;
+        return _lastEvent;
+    }
+    _readErrors = 0;
+
+    if (newTChks == 0)
+    {
+        if (++_zeroPolls >= healthStallPolls)
+            _lastEvent = HealthEvent::Stall;
+        return _lastEvent;
+    }
+    _zeroPolls = 0;
+
+    // Same throughput model as tuneStage1
+    float throughput = _minerInstance->getThroughput();
+    if (clk != _lastClock || throughput != _lastThroughput)
+    {
+        _lastClock = clk;
+        _lastThroughput = throughput;
+        restartBaseline();
+    }
+    double expected = (clk / 8) * throughput * pow(10, 6) * elapsedSeconds;
+    if (expected <= 0 || elapsedSeconds <= 0)
+        return updateShares();
+
+    double ratio = (double)newTChks / expected;
+    _rateEwma = (_rateEwma == 0) ? ratio : (1 - healthEwmaAlpha) * _rateEwma + healthEwmaAlpha * ratio;
+
+    if (_warmupPolls < healthWarmupPolls)
+    {
+        _baselineSum += ratio;
+        if (++_warmupPolls == healthWarmupPolls)
+            _baseline = _baselineSum / healthWarmupPolls;
+        return updateShares();
+    }
+
+    // One sided (lower) CUSUM on the rate relative to the learned baseline
+    _rateCusum = max(0.0, _rateCusum + (1.0 - healthRateSlack) - ratio / _baseline);
+    if (_rateCusum > healthRateThreshold)
+    {
+        _lastEvent = HealthEvent::Degradation;
+        return _lastEvent;
+    }
+
+    return updateShares();
+}
+
+HealthEvent HealthMonitor::updateShares()
+{
+    auto solutions = Farm::f().getSolutions(_minerIndex);
+    unsigned good = solutions.accepted + solutions.low;
+
+    // Counters get cleared by the tuner
+    if (solutions.failed < _lastFailed || good < _lastGood)
+    {
+        _lastFailed = solutions.failed;
+        _lastGood = good;
+        return HealthEvent::None;
+    }
+
+    unsigned newFailed = solutions.failed - _lastFailed;
+    unsigned newGood = good - _lastGood;
+    _lastFailed = solutions.failed;
+    _lastGood = good;
+
+    for (unsigned i = 0; i < newFailed + newGood; i++)
+    {
+        double x = (i < newFailed) ? 1.0 : 0.0;
+        _failedEwma = (1 - healthEwmaAlpha) * _failedEwma + healthEwmaAlpha * x;
+        _failedCusum = max(0.0, _failedCusum + x - healthFailedReference);
+    }
+    if (_failedCusum > healthFailedThreshold)
+        _lastEvent = HealthEvent::HashErrors;
+
+    return _lastEvent;
+}
+
+HealthAction HealthMonitor::actionFor(HealthEvent event)
+{
+    unsigned action = 0;
+    switch (event)
+    {
+    case HealthEvent::Stall:
+        action = _settings->healthStallAction;
+        break;
+    case HealthEvent::Degradation:
+        action = _settings->healthDegradeAction;
+        break;
+    case HealthEvent::HashErrors:
+        action = _settings->healthErrorAction;
+        break;
+    case HealthEvent::Link:
+        action = _settings->healthLinkAction;
+        break;
+    default:
+        break;
+    }
+    return (action > (unsigned)HealthAction::ReDAG) ? HealthAction::Alert : (HealthAction)action;
+}
+
+/*
+ * Called once the action for the last event was taken, starts learning again
+ */
+void HealthMonitor::acknowledge()
+{
+    _lastEvent = HealthEvent::None;
+    _zeroPolls = 0;
+    _readErrors = 0;
+    _failedCusum = 0;
+    restartBaseline();
+}
+
+string HealthMonitor::status()
+{
+    std::stringstream ss;
+    if (_warmupPolls < healthWarmupPolls)
+        ss << "learning";
+    else
+        ss << eventName(_lastEvent) << " " << std::fixed << std::setprecision(2) << _rateEwma
+           << "x";
+    ss << " fail " << std::fixed << std::setprecision(1) << _failedEwma * 100 << "%";
+    return ss.str();
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "SQRLMiner.h"
+
+namespace dev
+{
+namespace eth
+{
+enum class HealthEvent : uint8_t
+{
+    None,
+    Stall,        // No target checks at all
+    Degradation,  // Target check rate drifted below what clock x intensity should give
+    HashErrors,   // Failed share ratio drifted up
+    Link          // Counters could not be read
+};
+
+// Reaction to a health event, one per event type (--sqrl-health-* options)
+enum class HealthAction : uint8_t
+{
+    None,
+    Alert,
+    ResetCore,
+    Downclock,
+    ReDAG
+};
+
+class SQRLMiner;
+
+class HealthMonitor
+{
+private:
+    SQRLMiner* _minerInstance = NULL;
+    SQSettings* _settings = NULL;
+    unsigned _minerIndex = 0;
+
+    // Target check rate relative to the clock x intensity throughput model
+    unsigned _warmupPolls = 0;
+    double _baselineSum = 0;
+    double _baseline = 0;
+    double _rateEwma = 0;
+    double _rateCusum = 0;
+    unsigned _zeroPolls = 0;
+    unsigned _readErrors = 0;
+
+    // Failed shares, one Bernoulli sample per share
+    unsigned _lastFailed = 0;
+    unsigned _lastGood = 0;
+    double _failedEwma = 0;
+    double _failedCusum = 0;
+
+    // Operating point the baseline was learned at
+    double _lastClock = 0;
+    float _lastThroughput = 0;
+
+    HealthEvent _lastEvent = HealthEvent::None;
+
+    void restartBaseline();
+    HealthEvent updateShares();
+
+public:
+    HealthMonitor(SQRLMiner* minerInstance);
+    ~HealthMonitor(){};
+
+    HealthEvent update(uint64_t newTChks, double elapsedSeconds, bool countersRead, double clk);
+    HealthAction actionFor(HealthEvent event);
+    void acknowledge();
+    string status();
+
+    static const char* eventName(HealthEvent event);
+};
+
+
+}  // namespace eth
+}  // namespace dev
@@ -19,7 +19,10 @@
 #include <sys/socket.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <sys/select.h>
+#include <poll.h>
 #endif
 
 /* Sanity check for defined OS */
@@ -102,6 +105,9 @@ typedef struct _SQRLAXI {
 
   // Parameters
   uint32_t axiTimeoutMs;
+
+  // Statistics
+  uint64_t txCount;
 } SQRLAXI;	
 
 // Static Helpers
@@ -306,6 +312,7 @@ SQRLAXIResult _SQRLAXIDoTransaction(SQRLAXIRef self, uint8_t * reqPkt, uint8_t *
     SQRLMutexUnlock(&self->wMutex);
     return SQRLAXIResultBusy;
   }
+  self->txCount++;
   // Place our work packet in the queue
   if (respPkt != NULL) {
     memcpy(&(self->workPkts[self->wPktWr].rawReq), reqPkt, 16); 
@@ -396,8 +403,71 @@ SQRLAXIResult _SQRLAXIDoTransaction(SQRLAXIRef self, uint8_t * reqPkt, uint8_t *
   return SQRLAXIResultOK;
 }
 
+/*
+ * connect() that gives up after timeoutMs (0 blocks). The socket is left in
+ * blocking mode either way. poll() rather than select(), a probe of many hosts
+ * can take the descriptor past FD_SETSIZE
+ */
+static int _SQRLAXIConnect(SQRLAXIRef self, struct sockaddr_in * addr, uint32_t timeoutMs) {
+  if (timeoutMs == 0) {
+    return connect(self->fd, (struct sockaddr*)addr, sizeof(*addr));
+  }
+#ifdef _WIN32
+  u_long nonBlocking = 1;
+  ioctlsocket(self->fd, FIONBIO, &nonBlocking);
+#else
+  int flags = fcntl(self->fd, F_GETFL, 0);
+  fcntl(self->fd, F_SETFL, flags | O_NONBLOCK);
+#endif
+  int ret = connect(self->fd, (struct sockaddr*)addr, sizeof(*addr));
+  if (ret != 0) {
+#ifdef _WIN32
+    bool pending = (WSAGetLastError() == WSAEWOULDBLOCK);
+#else
+    bool pending = (errno == EINPROGRESS);
+#endif
+    if (pending) {
+      ret = -1;
+#ifdef _WIN32
+      // Winsock's fd_set is a list of sockets, not a bitmap - one always fits
+      fd_set wfds;
+      FD_ZERO(&wfds);
+      FD_SET(self->fd, &wfds);
+      struct timeval tv;
+      tv.tv_sec = timeoutMs / 1000;
+      tv.tv_usec = (timeoutMs % 1000) * 1000;
+      int ready = select((int)self->fd + 1, NULL, &wfds, NULL, &tv);
+#else
+      struct pollfd pfd;
+      pfd.fd = self->fd;
+      pfd.events = POLLOUT;
+      pfd.revents = 0;
+      int ready = poll(&pfd, 1, (int)timeoutMs);
+#endif
+      if (ready == 1) {
+        int soErr = 0;
+        sqrlsocklen_t len = sizeof(soErr);
+        if (getsockopt(self->fd, SOL_SOCKET, SO_ERROR, (char*)&soErr, &len) == 0 && soErr == 0) {
+          ret = 0;
+        }
+      }
+    }
+  }
+#ifdef _WIN32
+  nonBlocking = 0;
+  ioctlsocket(self->fd, FIONBIO, &nonBlocking);
+#else
+  fcntl(self->fd, F_SETFL, flags);
+#endif
+  return ret;
+}
+
 // Create will stall until TCP connection or FTDI connection is established
 SQRLAXIRef SQRLAXICreate(SQRLAXIConnectionType connection, char * hostOrFTDISerial, uint16_t port) {
+  return SQRLAXICreateWithTimeout(connection, hostOrFTDISerial, port, 0);
+}
+
+SQRLAXIRef SQRLAXICreateWithTimeout(SQRLAXIConnectionType connection, char * hostOrFTDISerial, uint16_t port, uint32_t connectTimeoutMs) {
   SQRLAXIRef self = (SQRLAXIRef)malloc(sizeof(SQRLAXI));
   if (self) {
     self->fd = INVALID_SOCKET;
@@ -419,6 +489,7 @@ SQRLAXIRef SQRLAXICreate(SQRLAXIConnectionType connection, char * hostOrFTDISeri
     self->iPktWr = 0;
     self->iPktRd = 0;
     self->axiTimeoutMs = 250;
+    self->txCount = 0;
 
     if (self->type == SQRLAXIConnectionTCP) {
       // Lookup ddress
@@ -449,9 +520,14 @@ SQRLAXIRef SQRLAXICreate(SQRLAXIConnectionType connection, char * hostOrFTDISeri
       if (ret != 0) {
         perror("NODELAY");// Don't abort on this
       }
-      ret = connect(self->fd, (struct sockaddr*)&server_addr, sizeof(server_addr));
+      ret = _SQRLAXIConnect(self, &server_addr, connectTimeoutMs);
       if (ret == -1) {
-        perror("connect");
+        if (connectTimeoutMs == 0) perror("connect");
+#ifdef _WIN32
+        closesocket(self->fd);
+#else
+        close(self->fd);
+#endif
 	if (self->host) free(self->host);
 	free(self);
 	return NULL;
@@ -574,6 +650,7 @@ SQRLAXIResult SQRLAXIWriteBulk(SQRLAXIRef self, uint8_t * buf, uint32_t len, uin
     SQRLMutexUnlock(&self->wMutex);
     return SQRLAXIResultBusy;
   }
+  self->txCount++;
   // Place our work packet in the queue
   memcpy(&(self->workPkts[self->wPktWr].rawReq), reqPkt, 16); 
   self->workPkts[self->wPktWr].rawReq[0] = 0x2; // Response doesn't have bulk flag
@@ -709,6 +786,41 @@ SQRLAXIResult SQRLAXIWriteBulk(SQRLAXIRef self, uint8_t * buf, uint32_t len, uin
   return SQRLAXIResultOK;
 }
 
+// Posted writes of several words to one address (e.g. a FIFO) - MUST BE THREADSAFE
+// All packets go out in a single send with the bus held, nothing can interleave
+SQRLAXIResult SQRLAXIWriteSequence(SQRLAXIRef self, uint32_t * data, uint32_t count, uint64_t address) {
+  if (self->fd == INVALID_SOCKET) return SQRLAXIResultNotConnected;
+  if (count == 0 || count > 64) return SQRLAXIResultInvalidParam;
+
+  uint8_t reqPkts[64*16];
+  SQRLMutexLock(&self->wMutex);
+  for (uint32_t i=0; i < count; i++) {
+    _SQRLAXIMakePacket(reqPkts + i*16, 0x02, self->seq++, address, data[i]);
+  }
+  self->txCount += count;
+
+  int bytesSent = 0;
+  int total = count*16;
+  while (bytesSent < total) {
+    int sent = send(self->fd, reqPkts+bytesSent, (total-bytesSent), 0);
+    if (sent <= 0) {
+      printf("SequenceSend failed!\n");
+      // Disconnect
+#ifdef _WIN32
+      closesocket(self->fd);
+#else
+      close(self->fd); 
+#endif
+      self->fd = 0;
+      SQRLMutexUnlock(&self->wMutex);
+      return SQRLAXIResultNotConnected;
+    }
+    bytesSent += sent;
+  }
+  SQRLMutexUnlock(&self->wMutex);
+  return SQRLAXIResultOK;
+}
+
 // Support CDMA operations
 SQRLAXIResult SQRLAXICDMAWriteBytes(SQRLAXIRef self, uint8_t *buffer, uint32_t len, uint64_t destAddr) {
   // AXI-CDMA core should be at 0x120000
@@ -1036,6 +1148,7 @@ SQRLAXIResult SQRLAXIWaitForInterrupt(SQRLAXIRef self, uint8_t interrupt, uint64
 }
 
 SQRLAXIResult SQRLAXIKickInterrupts(SQRLAXIRef self) {
+  if (self == NULL) return SQRLAXIResultInvalidParam;
   SQRLMutexLock(&self->iMutex);
   // Insert a "ForcedTimeout" interrupt into the queue
   self->iPkts[self->iPktWr].respRcvd = 1;
@@ -1057,6 +1170,13 @@ SQRLAXIResult SQRLAXISetTimeout(SQRLAXIRef self, uint32_t timeoutInMs) {
   return SQRLAXIResultOK;
 }
 
+uint64_t SQRLAXIGetTransactionCount(SQRLAXIRef self) {
+  SQRLMutexLock(&self->wMutex);
+  uint64_t count = self->txCount;
+  SQRLMutexUnlock(&self->wMutex);
+  return count;
+}
+
 uint16_t ModRTU_CRC(uint8_t * buf, int len)
 {
   uint16_t crc = 0xFFFF;
@@ -41,6 +41,8 @@ typedef CALLBACK_API_C(void, SQRLAXIInterruptCallback)(SQRLAXIRef axi, uint8_t i
 
 // Create will stall until TCP connection or FTDI connection is established
 SQRLAXIRef SQRLAXICreate(SQRLAXIConnectionType connection, char * hostOrFTDISerial, uint16_t port);
+// As above, but returns NULL if the TCP connection is not up within connectTimeoutMs (0 waits forever)
+SQRLAXIRef SQRLAXICreateWithTimeout(SQRLAXIConnectionType connection, char * hostOrFTDISerial, uint16_t port, uint32_t connectTimeoutMs);
 void SQRLAXIDestroy(SQRLAXIRef * self);
 
 // Access connected status of SQRLAXI Object
@@ -50,6 +52,8 @@ SQRLAXIResult SQRLAXIIsConnected(SQRLAXIRef self);
 SQRLAXIResult SQRLAXIWrite(SQRLAXIRef self, uint32_t data, uint64_t address, bool waitDone);
 // Write a bulk of data
 SQRLAXIResult SQRLAXIWriteBulk(SQRLAXIRef self, uint8_t * buf, uint32_t len, uint64_t address, uint8_t swapEndian);
+// Posted writes of a sequence of words to the same address, sent as one burst
+SQRLAXIResult SQRLAXIWriteSequence(SQRLAXIRef self, uint32_t * data, uint32_t count, uint64_t address);
 // Read from an AXI address
 SQRLAXIResult SQRLAXIRead(SQRLAXIRef self, uint32_t * dataOut, uint64_t address);
 
@@ -78,6 +82,9 @@ SQRLAXIResult SQRLAXIKickInterrupts(SQRLAXIRef self);
 // Parameters
 SQRLAXIResult SQRLAXISetTimeout(SQRLAXIRef self, uint32_t timeoutInMs);
 
+// Statistics - transactions issued on the bus since creation
+uint64_t SQRLAXIGetTransactionCount(SQRLAXIRef self);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,219 @@
+#include <cmath>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "SQRLIIC.h"
+
+using namespace std;
+using namespace dev;
+using namespace eth;
+
+// AXI IIC register offsets (PG090)
+#define IIC_ISR 0x020
+#define IIC_SOFTR 0x040
+#define IIC_CR 0x100
+#define IIC_SR 0x104
+#define IIC_TX_FIFO 0x108
+#define IIC_RX_FIFO 0x10C
+#define IIC_RX_FIFO_OCY 0x118
+#define IIC_RX_FIFO_PIRQ 0x120
+
+// TX FIFO dynamic mode control bits
+#define IIC_START 0x100
+#define IIC_STOP 0x200
+
+// Status polls before a transaction is given up on, about 1ms apart
+static const unsigned iicPolls = 50;
+
+static void iicSleep(unsigned ms)
+{
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
+SQRLAXIResult SQRLIIC::write(uint8_t addr, const vector<uint8_t>& bytes)
+{
+    if (bytes.empty())
+        return SQRLAXIResultInvalidParam;
+
+    vector<uint32_t> fifo;
+    fifo.push_back(IIC_START | (addr << 1));
+    for (size_t i = 0; i < bytes.size(); i++)
+        fifo.push_back(bytes[i] | ((i == bytes.size() - 1) ? IIC_STOP : 0));
+    return transact(fifo, 0, NULL);
+}
+
+/*
+ * Write cmd (if any), then a repeated start reading len bytes
+ */
+SQRLAXIResult SQRLIIC::read(uint8_t addr, const vector<uint8_t>& cmd, uint8_t len, vector<uint8_t>& out)
+{
+    if (len == 0)
+        return SQRLAXIResultInvalidParam;
+
+    vector<uint32_t> fifo;
+    if (!cmd.empty())
+    {
+        fifo.push_back(IIC_START | (addr << 1));
+        for (auto b : cmd)
+            fifo.push_back(b);
+    }
+    fifo.push_back(IIC_START | (addr << 1) | 1);
+    fifo.push_back(IIC_STOP | len);
+    return transact(fifo, len, &out);
+}
+
+SQRLAXIResult SQRLIIC::transact(vector<uint32_t>& fifo, uint8_t readLen, vector<uint8_t>* readData)
+{
+    SQRLAXIResult err = SQRLAXIResultFailed;
+    for (unsigned attempt = 0; attempt <= _retries; attempt++)
+    {
+        if (attempt > 0)
+        {
+            _naks++;
+            iicSleep(1);
+        }
+
+        // Soft reset clears the FIFOs and any error left from the last attempt
+        err = SQRLAXIWrite(_axi, 0xA, _base + IIC_SOFTR, false);
+        if (err == SQRLAXIResultOK && readLen)
+            err = SQRLAXIWrite(_axi, readLen - 1, _base + IIC_RX_FIFO_PIRQ, false);
+        if (err == SQRLAXIResultOK)
+            err = SQRLAXIWriteSequence(_axi, fifo.data(), fifo.size(), _base + IIC_TX_FIFO);
+        if (err == SQRLAXIResultOK)
+            err = SQRLAXIWrite(_axi, 0x1, _base + IIC_CR, false);  // Enable, sends the FIFO
+        if (err == SQRLAXIResultNotConnected)
+            return err;
+        if (err == SQRLAXIResultOK)
+            err = waitDone(readLen);
+        if (err != SQRLAXIResultOK)
+            continue;
+
+        if (readData)
+        {
+            readData->clear();
+            for (unsigned i = 0; i < readLen && err == SQRLAXIResultOK; i++)
+            {
+                uint32_t v = 0;
+                err = SQRLAXIRead(_axi, &v, _base + IIC_RX_FIFO);
+                readData->push_back(v & 0xFF);
+            }
+            if (err != SQRLAXIResultOK)
+                continue;
+        }
+        return SQRLAXIResultOK;
+    }
+    return err;
+}
+
+/*
+ * Done when the core drained the TX FIFO (and for reads, filled the RX FIFO)
+ * and released the bus. A NAK or lost arbitration shows up in the ISR
+ */
+SQRLAXIResult SQRLIIC::waitDone(uint8_t readLen)
+{
+    for (unsigned i = 0; i < iicPolls; i++)
+    {
+        uint32_t isr = 0, sr = 0;
+        if (SQRLAXIRead(_axi, &isr, _base + IIC_ISR) != SQRLAXIResultOK ||
+            SQRLAXIRead(_axi, &sr, _base + IIC_SR) != SQRLAXIResultOK)
+            return SQRLAXIResultFailed;
+
+        if (isr & 0x3)  // Arbitration lost / transmit error (NAK)
+            return SQRLAXIResultFailed;
+
+        bool txEmpty = (sr & (1 << 7)) != 0;
+        bool busBusy = (sr & (1 << 2)) != 0;
+        if (txEmpty && !busBusy)
+        {
+            if (!readLen)
+                return SQRLAXIResultOK;
+            uint32_t ocy = 0;
+            if (SQRLAXIRead(_axi, &ocy, _base + IIC_RX_FIFO_OCY) != SQRLAXIResultOK)
+                return SQRLAXIResultFailed;
+            bool rxEmpty = (sr & (1 << 6)) != 0;
+            if (!rxEmpty && (ocy & 0xF) + 1 >= readLen)
+                return SQRLAXIResultOK;
+        }
+        iicSleep(1);
+    }
+    return SQRLAXIResultTimedOut;
+}
+
+/*
+ * Points the paged commands of a multi-rail regulator at one rail. Only
+ * trusted once PAGE reads back as written, so nothing is reported for the
+ * wrong rail
+ */
+SQRLAXIResult SQRLIIC::selectPage(uint8_t addr, uint8_t page)
+{
+    SQRLAXIResult err = write(addr, {PMBUS_PAGE, page});
+    if (err != SQRLAXIResultOK)
+        return err;
+    uint8_t current = 0;
+    err = readByte(addr, PMBUS_PAGE, current);
+    if (err != SQRLAXIResultOK)
+        return err;
+    return (current == page) ? SQRLAXIResultOK : SQRLAXIResultFailed;
+}
+
+SQRLAXIResult SQRLIIC::readByte(uint8_t addr, uint8_t cmd, uint8_t& value)
+{
+    vector<uint8_t> data;
+    SQRLAXIResult err = read(addr, {cmd}, 1, data);
+    if (err == SQRLAXIResultOK)
+        value = data[0];
+    return err;
+}
+
+SQRLAXIResult SQRLIIC::readWord(uint8_t addr, uint8_t cmd, uint16_t& value)
+{
+    vector<uint8_t> data;
+    SQRLAXIResult err = read(addr, {cmd}, 2, data);
+    if (err == SQRLAXIResultOK)
+        value = data[0] | (data[1] << 8);  // PMBus words are little endian
+    return err;
+}
+
+SQRLAXIResult SQRLIIC::readVout(uint8_t addr, double& volts)
+{
+    // Regulators that don't answer VOUT_MODE use the exponent setVoltage programs with
+    uint8_t mode = 0x18;  // -8
+    readByte(addr, PMBUS_VOUT_MODE, mode);
+    uint16_t raw;
+    SQRLAXIResult err = readWord(addr, PMBUS_READ_VOUT, raw);
+    if (err == SQRLAXIResultOK)
+        volts = linear16(raw, mode);
+    return err;
+}
+
+SQRLAXIResult SQRLIIC::readLinear11(uint8_t addr, uint8_t cmd, double& value)
+{
+    uint16_t raw;
+    SQRLAXIResult err = readWord(addr, cmd, raw);
+    if (err == SQRLAXIResultOK)
+        value = linear11(raw);
+    return err;
+}
+
+// 5 bit signed exponent, 11 bit signed mantissa
+double SQRLIIC::linear11(uint16_t raw)
+{
+    int exponent = (int16_t)raw >> 11;
+    int mantissa = (int16_t)(raw << 5) >> 5;
+    return mantissa * pow(2.0, exponent);
+}
+
+// Unsigned mantissa, exponent from the low 5 bits of VOUT_MODE
+double SQRLIIC::linear16(uint16_t raw, uint8_t voutMode)
+{
+    int exponent = (int8_t)(voutMode << 3) >> 3;
+    return raw * pow(2.0, exponent);
+}
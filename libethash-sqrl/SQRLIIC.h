@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+
+#include "SQRLAXI.h"
+
+namespace dev
+{
+namespace eth
+{
+// AXI IIC cores the board regulators hang off
+#define SQRL_IIC_FK 0x9000
+#define SQRL_IIC_JC 0xA000
+
+// PMBus commands
+#define PMBUS_PAGE 0x00
+#define PMBUS_VOUT_MODE 0x20
+#define PMBUS_READ_VIN 0x88
+#define PMBUS_READ_VOUT 0x8B
+#define PMBUS_READ_IOUT 0x8C
+#define PMBUS_READ_TEMPERATURE_1 0x8D
+#define PMBUS_READ_POUT 0x96
+#define PMBUS_READ_PIN 0x97
+
+// Acadia regulator on JC boards, and its loop codes - the same in the
+// single-shot paged command (0xD0) setVoltage writes with and in PAGE
+#define ACADIA_ADDR 0x4d
+#define ACADIA_LOOP_VCCINT 0x06
+#define ACADIA_LOOP_VCCBRAM 0x0A
+
+/*
+ * Transactions on a Xilinx AXI IIC core in dynamic mode. A whole transaction
+ * (start, address, command, data, stop) is queued into the TX FIFO as one burst,
+ * then the core is started and its status waited on. NAKs, arbitration loss and
+ * timeouts are retried after a soft reset. Callers hold the AXI mutex
+ */
+class SQRLIIC
+{
+private:
+    SQRLAXIRef _axi;
+    uint64_t _base;
+    unsigned _retries;
+    unsigned _naks = 0;
+
+    SQRLAXIResult transact(
+        std::vector<uint32_t>& fifo, uint8_t readLen, std::vector<uint8_t>* readData);
+    SQRLAXIResult waitDone(uint8_t readLen);
+
+public:
+    SQRLIIC(SQRLAXIRef axi, uint64_t base, unsigned retries = 3)
+      : _axi(axi), _base(base), _retries(retries)
+    {}
+
+    // Raw IIC - 7 bit device address
+    SQRLAXIResult write(uint8_t addr, const std::vector<uint8_t>& bytes);
+    SQRLAXIResult read(
+        uint8_t addr, const std::vector<uint8_t>& cmd, uint8_t len, std::vector<uint8_t>& out);
+
+    // PMBus
+    SQRLAXIResult selectPage(uint8_t addr, uint8_t page);
+    SQRLAXIResult readByte(uint8_t addr, uint8_t cmd, uint8_t& value);
+    SQRLAXIResult readWord(uint8_t addr, uint8_t cmd, uint16_t& value);
+    SQRLAXIResult readVout(uint8_t addr, double& volts);
+    SQRLAXIResult readLinear11(uint8_t addr, uint8_t cmd, double& value);
+
+    static double linear11(uint16_t raw);
+    static double linear16(uint16_t raw, uint8_t voutMode);
+
+    // Attempts repeated after a NAK, lost arbitration or timeout
+    unsigned getNaks() { return _naks; }
+};
+
+
+}  // namespace eth
+}  // namespace dev
@@ -39,7 +39,16 @@ along with ethminer.  If not, see <http://www.gnu.org/licenses/>.
 #include <libethcore/Farm.h>
 #include <ethash/ethash.hpp>
 
+#include <algorithm>
+#include <condition_variable>
+#include <random>
+#include <set>
+#include <thread>
+
 #include "SQRLMiner.h"
+#include "HealthMonitor.h"
+#include "ThermalGovernor.h"
+#include "SQRLIIC.h"
 
 
 /* Sanity check for defined OS */
@@ -86,6 +95,37 @@ static uint32_t eswap32(uint32_t in) {
          );
 }
 
+// DAG items are generated linearly into HBM stack 1, then duplicated to both stacks
+// with the 16MB chunk index nibble-swapped (see initEpoch_internal)
+static uint64_t dagItemAddress(uint32_t item) {
+  uint64_t offset = (uint64_t)item * 128ULL;
+  uint64_t chunk = (offset >> 24) & 0xFF;
+  return ((((chunk & 0x0f) << 4) | ((chunk & 0xF0) >> 4)) << 24) | (offset & 0xFFFFFF);
+}
+
+// Power model of boards without PMBus readings - rough figures for a VU35P
+// board at stock VCCINT: static draw, plus watts per MHz of full throughput
+static const double sqrlStaticWatts = 45.0;
+static const double sqrlWattsPerMHz = 0.25;
+
+// Probes in flight at once, across all callers - each holds a thread and a socket
+static const unsigned probeConcurrency = 128;
+
+// Nonces remembered per job to drop a result seen on two wakes
+static const size_t submittedNonceHistory = 256;
+
+// Interval of the PMBus power reads, a few IIC transactions each
+static const unsigned powerReadIntervalMs = 5000;
+
+// verifyDAG result when the sample is mostly unreadable, neither pass nor fail
+static const uint8_t dagVerifyUnread = 0x80;
+
+// Only declared in ethash's internal header, but exported by the library
+namespace ethash
+{
+hash1024 calculate_dataset_item_1024(const epoch_context& context, uint32_t index) noexcept;
+}
+
 /* ################## OS-specific functions ################## */
 
 /*
@@ -110,11 +150,13 @@ unsigned SQRLMiner::getNumDevices(SQSettings _settings)
 
 
 
-SQRLMiner::SQRLMiner(unsigned _index, SQSettings _settings, DeviceDescriptor& _device, TelemetryType* telemetry)
+SQRLMiner::SQRLMiner(unsigned _index, SQSettings _settings, DeviceDescriptor& _device)
   : Miner("sqrl-", _index), m_settings(_settings)
 {
     m_deviceDescriptor = _device;
-    m_tuner = new AutoTuner(this, telemetry);
+    m_tuner = new AutoTuner(this);
+    m_health = new HealthMonitor(this);
+    m_governor = new ThermalGovernor(this);
 }
 
 
@@ -123,6 +165,8 @@ SQRLMiner::~SQRLMiner()
     DEV_BUILD_LOG_PROGRAMFLOW(sqrllog, "sq-" << m_index << " SQRLMiner::~SQRLMiner() begin");
     stopWorking();
     kick_miner();
+    if (m_tuner != NULL)
+        saveHistory();
     DEV_BUILD_LOG_PROGRAMFLOW(sqrllog, "sq-" << m_index << " SQRLMiner::~SQRLMiner() end");
 
     // Close socket
@@ -132,6 +176,10 @@ SQRLMiner::~SQRLMiner()
     }
     if (m_tuner != NULL)
         delete m_tuner;
+    if (m_health != NULL)
+        delete m_health;
+    if (m_governor != NULL)
+        delete m_governor;
 }
 
 // Full formula (VID being a voltage ID from 0 - 255, inclusive):
@@ -244,6 +292,38 @@ SQRLAXIResult SQRLMiner::StopHashcore(bool soft)
     }
 }
 
+/*
+ * Reads the capability block, keeping the defaults on bitstreams without one
+ */
+void SQRLMiner::readCapabilities()
+{
+  uint32_t magic = 0, features = 0, layout = 0;
+  m_caps = SQRLCapabilities();
+  if (SQRLAXIRead(m_axi, &magic, SQRL_CAPS_MAGIC_ADDR) != SQRLAXIResultOK || magic != SQRL_CAPS_MAGIC) {
+    sqrllog << "Capabilities: not reported, assuming on-chip cache, interrupts, "
+            << m_caps.nonceSlots << " nonce slots, " << m_caps.dagMixers << " mixers";
+    return;
+  }
+  if (SQRLAXIRead(m_axi, &features, SQRL_CAPS_FEATURES_ADDR) != SQRLAXIResultOK ||
+      SQRLAXIRead(m_axi, &layout, SQRL_CAPS_LAYOUT_ADDR) != SQRLAXIResultOK) {
+    sqrllog << EthRed << "Capabilities: error reading block, using defaults" << EthReset;
+    return;
+  }
+
+  m_caps.reported = true;
+  m_caps.cacheOnChip = (features & SQRL_CAP_CACHE_ON_CHIP) != 0;
+  m_caps.nonceInterrupts = (features & SQRL_CAP_NONCE_INTERRUPT) != 0;
+  // Layout - mixers in bits 0-7, nonce slots in bits 8-11
+  if (layout & 0xFF)
+    m_caps.dagMixers = layout & 0xFF;
+  unsigned slots = (layout >> 8) & 0xF;
+  if (slots)
+    m_caps.nonceSlots = std::min(slots, 4u);  // Only four slot registers are mapped
+  sqrllog << "Capabilities: " << (m_caps.cacheOnChip ? "on-chip cache" : "host cache upload")
+          << ", " << (m_caps.nonceInterrupts ? "interrupt" : "polled") << " nonces, "
+          << m_caps.nonceSlots << " nonce slots, " << m_caps.dagMixers << " mixers";
+}
+
 bool SQRLMiner::initDevice()
 {
     DEV_BUILD_LOG_PROGRAMFLOW(sqrllog, "sq-" << m_index << " SQRLMiner::initDevice begin");
@@ -253,12 +333,13 @@ bool SQRLMiner::initDevice()
     m_hwmoninfo.deviceType = HwMonitorInfoType::SQRL;
 
     SQRLAXIResult err;
-    SQRLAXIRef axi = SQRLAXICreate(SQRLAXIConnectionTCP, (char *)m_deviceDescriptor.sqHost.c_str(), m_deviceDescriptor.sqPort);
+    // Bounded so an unreachable board fails init (and gets retried) rather than hang the worker
+    SQRLAXIRef axi = SQRLAXICreateWithTimeout(SQRLAXIConnectionTCP, (char *)m_deviceDescriptor.sqHost.c_str(), m_deviceDescriptor.sqPort, m_settings.probeTimeoutMs);
     if (axi != NULL) {
       SQRLAXISetTimeout(axi, m_settings.axiTimeoutMs);
       // Only affects interrupts from the multi-client bridge
-      // used for dual-mining
-      SQRLAXIEnableInterruptsWithMask(axi, 0x1);
+      // used for dual-mining - nonces and DAGGEN completion
+      SQRLAXIEnableInterruptsWithMask(axi, SQRL_NONCE_INTERRUPT | SQRL_DAGGEN_INTERRUPT);
       sqrllog << m_deviceDescriptor.name << " Connected";
       m_axi = axi;
 
@@ -306,34 +387,72 @@ bool SQRLMiner::initDevice()
       s << setfill('0') << setw(8) << std::hex << bitstream;
       sqrllog << "Bitstream: " << s.str();
       m_settingID += s.str() + "_";
+      m_deviceKey = m_settingID.substr(0, m_settingID.size() - 1);
+      stateStore().update(m_deviceKey, [](SQRLDeviceState& state) {
+        state.sessions++;
+        state.lastSeen = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+      });
+
+      readCapabilities();
+      if (m_settings.dagMixers == 0) {
+        m_settings.dagMixers = m_caps.dagMixers;
+      } else if (m_caps.reported && m_settings.dagMixers != m_caps.dagMixers) {
+        // A wrong mixer count builds a bad DAG without any error
+        sqrllog << EthRed << "--sqrl-dag-mixers " << m_settings.dagMixers
+                << " does not match the bitstream's " << m_caps.dagMixers
+                << " mixers - refusing to mine on " << m_deviceDescriptor.name << EthReset;
+        stateStore().update(m_deviceKey, [](SQRLDeviceState& state) { state.initFailures++; });
+        return false;
+      }
 
       InitVoltageTbl();
 
       m_settingID += format2decimal(m_settings.fkVCCINT);
       m_settingID += format2decimal(m_settings.jcVCCINT);
-   
-      setVoltage(m_settings.fkVCCINT, m_settings.jcVCCINT);
-     
 
-      // Initialize clk
-      sqrllog << "Stock Clock: " << setClock(-2);
-      if ( m_deviceDescriptor.targetClk != 0) {
-        sqrllog << "Target Clock: " << m_deviceDescriptor.targetClk; 
-	// Target Clock set after Dag Generation
-	m_lastClk = m_deviceDescriptor.targetClk;
+      sqrllog << "TuneID=" << m_settingID;
+      if (m_settings.warmAttach && tryWarmAttach()) {
+        // Voltage, clock and intensity are left as the previous run configured them
+        sqrllog << EthLime << "Warm attach: Epoch " << m_warmEpoch << " at " << m_lastClk << "MHz" << EthReset;
       } else {
-        m_lastClk = getClock();
-      }
+        setVoltage(m_settings.fkVCCINT, m_settings.jcVCCINT);
+
+        // Initialize clk
+        sqrllog << "Stock Clock: " << setClock(-2);
+        if ( m_deviceDescriptor.targetClk != 0) {
+          sqrllog << "Target Clock: " << m_deviceDescriptor.targetClk; 
+	  // Target Clock set after Dag Generation
+	  m_lastClk = m_deviceDescriptor.targetClk;
+        } else {
+          m_lastClk = getClock();
+        }
 
-      sqrllog << "TuneID=" << m_settingID;
-      if (boost::filesystem::exists(m_settings.tuneFile) && m_settings.autoTune > 0)
-      {
-          bool tuneFound = m_tuner->readSavedTunes(m_settings.tuneFile, m_settingID);
+        SQRLDeviceState state;
+        if (m_settings.autoTune > 0 && loadDeviceState(state)) {
+          if (state.tunedClock > 0 && state.tunedFkVCCINT == m_settings.fkVCCINT &&
+              state.tunedJcVCCINT == m_settings.jcVCCINT) {
+            if (m_tuner->applySavedState(state))
+              m_settings.autoTune = 0;  // Tuned before at these voltages
+          } else if (m_deviceDescriptor.targetClk == 0 && state.goodClock > 0 &&
+                     state.goodFkVCCINT == m_settings.fkVCCINT &&
+                     state.goodJcVCCINT == m_settings.jcVCCINT) {
+            // Tuning starts from where the board last ran clean rather than stock
+            sqrllog << "Last known good clock: " << state.goodClock << " ("
+                    << state.goodShares + state.failedShares << " shares,"
+                    << format2decimal((state.errorRate() * 100)) << "% errors)";
+            m_lastClk = state.goodClock;
+          }
+        }
+
+        if (boost::filesystem::exists(m_settings.tuneFile) && m_settings.autoTune > 0)
+        {
+            bool tuneFound = m_tuner->readSavedTunes(m_settings.tuneFile, m_settingID);
 
-          if (tuneFound)
-            m_settings.autoTune = 0; //if tune file exists, apply the tune and disable auto-tuning
+            if (tuneFound)
+              m_settings.autoTune = 0; //if tune file exists, apply the tune and disable auto-tuning
+        }
       }
-      
 
 
       // Print the settings
@@ -355,6 +474,7 @@ bool SQRLMiner::initDevice()
 
     void SQRLMiner::setVoltage(unsigned fkVCCINT, unsigned jcVCCINT)
 {
+    std::lock_guard<std::mutex> l(iicMutex);
     unsigned upperVoltLimit = 920;
     unsigned lowerVoltLimit = 500;
 
@@ -375,11 +495,14 @@ bool SQRLMiner::initDevice()
 
             sqrllog << "Instructing FK VRM, if present, to target " << fkVCCINT << "mv";
             sqrllog << "Closest Viable Voltage " << tmv << "mv";
-            SQRLAXIWrite(m_axi, 0xA, 0x9040, false);
-            SQRLAXIWrite(m_axi, 0x158, 0x9108, false);
-            SQRLAXIWrite(m_axi, 0x00, 0x9108, false);
-            SQRLAXIWrite(m_axi, 0x200 | tWiper, 0x9108, false);
-            SQRLAXIWrite(m_axi, 0x1, 0x9100, false);
+            SQRLIIC fk(m_axi, SQRL_IIC_FK);
+            vector<uint8_t> wiper;
+            if (fk.write(0x2C, {0x00, tWiper}) != SQRLAXIResultOK)
+                sqrllog << EthRed << "FK VRM did not acknowledge the wiper write" << EthReset;
+            else if (fk.read(0x2C, {}, 1, wiper) != SQRLAXIResultOK || wiper[0] != tWiper)
+                sqrllog << EthOrange << "FK VRM wiper readback mismatch" << EthReset;
+            else
+                sqrllog << "FK VRM wiper readback " << to_string(wiper[0]) << " confirmed";
         }
     }
     if (jcVCCINT != 0)
@@ -390,84 +513,100 @@ bool SQRLMiner::initDevice()
 
         else  // Set voltage if asked
         {
+            // Acadia regulator - SingleShotPage+Cmd, Write, CMD << 1, loop, data lo, data hi
+            const uint8_t acadia = ACADIA_ADDR;
+            SQRLIIC jc(m_axi, SQRL_IIC_JC);
+            uint16_t vEnc = (uint16_t)(((double)jcVCCINT / 1000.0) * 256.0);
+            vector<vector<uint8_t>> writes = {
+                {0xD0, 0x04, 0x22, 0x08, 0x1C, 0x5C},                 // VCCBRAM loop PID
+                {0xD0, 0x04, 0x24, 0x08, 0x22, 0x2C},                 // VCCBRAM loop PID
+                {0xD0, 0x04, 0xAA, ACADIA_LOOP_VCCBRAM, 0xf3, 0xe0},  // VCCBRAM OV_FAULT
+                {0xD0, 0x04, 0xAA, ACADIA_LOOP_VCCINT, 0xf3, 0xe0},   // VCCINT OV_FAULT
+                {0xD0, 0x04, (0x21 << 1), ACADIA_LOOP_VCCINT, (uint8_t)(vEnc & 0xFF),
+                    (uint8_t)((vEnc >> 8) & 0xFF)}};  // VCCINT VOUT_COMMAND
+
             sqrllog << "Applying JCM PMIC Hot Fix";
-            SQRLAXIWrite(m_axi, 0xA, 0xA040, false); // Soft Reset IIC 	
-            SQRLAXIWrite(m_axi, 0x100|(0x4d<<1), 0xA108, false); // Transmit FIFO byte 1 (Write(startbit), Addr, Acadia) 	
-            SQRLAXIWrite(m_axi, 0xD0, 0xA108, false); // Transmit FIFO byte 2 (SingleShotPage+Cmd)
-            SQRLAXIWrite(m_axi, 0x04, 0xA108, false); // Transmit FIFO byte 3 (Write)
-            SQRLAXIWrite(m_axi, 0x22, 0xA108, false); // Transmit FIFO byte 4 (AddrLo (CMD)	
-            SQRLAXIWrite(m_axi, 0x08, 0xA108, false); // Transmit FIFO byte 2, VCCBRAM loop PID 
-            SQRLAXIWrite(m_axi, 0x1C , 0xA108, false); // Transmit FIFO byte 3 // new param lo
-            SQRLAXIWrite(m_axi, 0x200 | 0x5C, 0xA108, false); // Transmit FIFO byte 4 // new param hi (With Stop)
-            SQRLAXIWrite(m_axi, 0x100|(0x4d<<1), 0xA108, false); // Transmit FIFO byte 1 (Write(startbit), Addr, Acadia) 	
-            SQRLAXIWrite(m_axi, 0xD0, 0xA108, false); // Transmit FIFO byte 2 (SingleShotPage+Cmd)
-            SQRLAXIWrite(m_axi, 0x04, 0xA108, false); // Transmit FIFO byte 3 (Write)
-            SQRLAXIWrite(m_axi, 0x24, 0xA108, false); // Transmit FIFO byte 4 (AddrLo (CMD)	
-            SQRLAXIWrite(m_axi, 0x08, 0xA108, false); // Transmit FIFO byte 2, VCCBRAM loop PID 
-            SQRLAXIWrite(m_axi, 0x22 , 0xA108, false); // Transmit FIFO byte 3 // new param lo
-            SQRLAXIWrite(m_axi, 0x200 | 0x2C, 0xA108, false); // Transmit FIFO byte 4 // new param hi (With Stop)
-            SQRLAXIWrite(m_axi, 0x1, 0xA100, false); // Send IIC transaction 	
-#ifdef _WIN32
-            Sleep(1000);
-#else
-            usleep(1000000);
-#endif
-            SQRLAXIWrite(m_axi, 0xA, 0xA040, false);  // Soft Reset IIC
-            SQRLAXIWrite(m_axi, 0x100 | (0x4d << 1), 0xA108,
-                false);  // Transmit FIFO byte 1 (Write(startbit), Addr, Acadia)
-            SQRLAXIWrite(m_axi, 0xD0, 0xA108, false);  // Transmit FIFO byte 2
-                                                       // (SingleShotPage+Cmd)
-            SQRLAXIWrite(m_axi, 0x04, 0xA108, false);  // Transmit FIFO byte 3 (Write)
-            SQRLAXIWrite(m_axi, 0xAA, 0xA108, false);  // Transmit FIFO byte 4 (AddrLo (CMD)
-            SQRLAXIWrite(m_axi, 0x0A, 0xA108, false);  // Transmit FIFO byte 2, VCCBRAM_OV_FAULT
-            SQRLAXIWrite(m_axi, 0xf3, 0xA108, false);  // Transmit FIFO byte 3 // vEnc[0]
-            SQRLAXIWrite(m_axi, 0x200 | 0xe0, 0xA108, false);  // Transmit FIFO byte 4 //
-                                                               // vEnc[1] (With Stop)
-            SQRLAXIWrite(m_axi, 0x1, 0xA100, false);           // Send IIC transaction
+            sqrllog << "Asking JCM VRM, if present, to target " << jcVCCINT << "mv";
+            bool acked = true;
+            for (size_t i = 0; i < writes.size(); i++)
+            {
+                auto const& w = writes[i];
+                if (jc.write(acadia, w) != SQRLAXIResultOK)
+                {
+                    sqrllog << EthRed << "JCM VRM did not acknowledge command 0x" << std::hex
+                            << (unsigned)(w[2] >> 1) << std::dec << EthReset;
+                    acked = false;
+                    break;
+                }
+                // An ACK only says the command arrived - give the regulator time to take
+                // in each hot fix limit (the PID pair together) before VOUT moves
+                if (i >= 1 && i + 1 < writes.size())
+                {
 #ifdef _WIN32
-            Sleep(1000);
+                    Sleep(1000);
 #else
-            usleep(1000000);
+                    usleep(1000000);
 #endif
-            SQRLAXIWrite(m_axi, 0xA, 0xA040, false);  // Soft Reset IIC
-            SQRLAXIWrite(m_axi, 0x100 | (0x4d << 1), 0xA108,
-                false);  // Transmit FIFO byte 1 (Write(startbit), Addr, Acadia)
-            SQRLAXIWrite(m_axi, 0xD0, 0xA108, false);  // Transmit FIFO byte 2
-                                                       // (SingleShotPage+Cmd)
-            SQRLAXIWrite(m_axi, 0x04, 0xA108, false);  // Transmit FIFO byte 3 (Write)
-            SQRLAXIWrite(m_axi, 0xAA, 0xA108, false);  // Transmit FIFO byte 4 (AddrLo (CMD)
-            SQRLAXIWrite(m_axi, 0x06, 0xA108, false);  // Transmit FIFO byte 2, VCCINT OV_FAULT
-            SQRLAXIWrite(m_axi, 0xf3, 0xA108, false);  // Transmit FIFO byte 3 // vEnc[0]
-            SQRLAXIWrite(m_axi, 0x200 | 0xe0, 0xA108, false);  // Transmit FIFO byte 4 //
-                                                               // vEnc[1] (With Stop)
-            SQRLAXIWrite(m_axi, 0x1, 0xA100, false);           // Send IIC transaction
+                }
+            }
 
-            sqrllog << "Asking JCM VRM, if present, to target " << jcVCCINT << "mv";
+            // The readbacks are paged, point them at VCCINT
+            bool paged = acked && jc.selectPage(acadia, ACADIA_LOOP_VCCINT) == SQRLAXIResultOK;
+            if (acked && !paged)
+                sqrllog << EthOrange << "JCM VRM did not take the VCCINT page, readback skipped"
+                        << EthReset;
 
+            // Give the output time to slew, then verify what the regulator reports
+            double vout = 0, iout = 0, temp = 0;
+            for (int i = 0; paged && i < 10; i++)
+            {
+                if (jc.readVout(acadia, vout) != SQRLAXIResultOK)
+                    break;
+                if (fabs(vout * 1000 - jcVCCINT) <= 10)
+                    break;
 #ifdef _WIN32
-            Sleep(1000);
+                Sleep(20);
 #else
-            usleep(1000000);
+                usleep(20000);
 #endif
-            uint16_t vEnc = (uint16_t)(((double)jcVCCINT / 1000.0) * 256.0);
-            SQRLAXIWrite(m_axi, 0xA, 0xA040, false);  // Soft Reset IIC
-            SQRLAXIWrite(m_axi, 0x100 | (0x4d << 1), 0xA108,
-                false);  // Transmit FIFO byte 1 (Write(startbit), Addr, Acadia)
-            SQRLAXIWrite(m_axi, 0xD0, 0xA108, false);         // Transmit FIFO byte 2
-                                                              // (SingleShotPage+Cmd)
-            SQRLAXIWrite(m_axi, 0x04, 0xA108, false);         // Transmit FIFO byte 3 (Write)
-            SQRLAXIWrite(m_axi, (0x21 << 1), 0xA108, false);  // Transmit FIFO byte 4 (AddrLo
-                                                              // (CMD)
-            SQRLAXIWrite(m_axi, 0x06, 0xA108, false);         // Transmit FIFO byte 2, VOUT CMD
-            SQRLAXIWrite(m_axi, 0x0 | (vEnc & 0xFF), 0xA108, false);  // Transmit FIFO byte 3 //
-                                                                      // vEnc[0]
-            SQRLAXIWrite(m_axi, 0x200 | ((vEnc >> 8) & 0xFF), 0xA108,
-                false);                               // Transmit FIFO byte 4 // vEnc[1] (With Stop)
-            SQRLAXIWrite(m_axi, 0x1, 0xA100, false);  // Send IIC transaction
+            }
+            if (paged && vout > 0)
+            {
+                jc.readLinear11(acadia, PMBUS_READ_IOUT, iout);
+                jc.readLinear11(acadia, PMBUS_READ_TEMPERATURE_1, temp);
+                sqrllog << ((fabs(vout * 1000 - jcVCCINT) <= 10) ? EthWhite : EthOrange)
+                        << "JCM VRM readback " << format2decimal(vout) << "V "
+                        << format2decimal(iout) << "A " << format2decimal(temp) << "C" << EthReset;
+            }
+            if (jc.getNaks())
+                sqrllog << "JCM VRM needed " << jc.getNaks() << " retries";
         }
     }
 }
 
+/*
+ * VCCINT in mV as the regulators report it, 0 for one that does not answer.
+ * The FK wiper maps back through the VID table, the JC regulator reads VOUT
+ * on its VCCINT page
+ */
+void SQRLMiner::readVoltage(unsigned& fkVCCINT, unsigned& jcVCCINT)
+{
+    fkVCCINT = 0;
+    jcVCCINT = 0;
+
+    std::lock_guard<std::mutex> l(iicMutex);
+    SQRLIIC fk(m_axi, SQRL_IIC_FK);
+    vector<uint8_t> wiper;
+    if (fk.read(0x2C, {}, 1, wiper) == SQRLAXIResultOK && !wiper.empty())
+        fkVCCINT = (unsigned)lround(LookupVID(wiper[0]) * 1000.0);
+
+    SQRLIIC jc(m_axi, SQRL_IIC_JC, 0);
+    double vout = 0;
+    if (jc.selectPage(ACADIA_ADDR, ACADIA_LOOP_VCCINT) == SQRLAXIResultOK &&
+        jc.readVout(ACADIA_ADDR, vout) == SQRLAXIResultOK && vout > 0)
+        jcVCCINT = (unsigned)lround(vout * 1000.0);
+}
+
     /*
  * A new epoch was receifed with last work package (called from Miner::initEpoch())
  *
@@ -483,6 +622,25 @@ bool SQRLMiner::initEpoch_internal()
     // m_epochContext.dagSize
     // m_epochContext.lightCache
    
+    // Warm attach - the board already holds this epoch at the persisted clock and intensity,
+    // only the ethcore parameters are refreshed and hashing resumes on the first job
+    if (m_warmAttach) {
+      m_warmAttach = false;
+      if (m_warmEpoch == m_epochContext.epochNumber) {
+        SQRLDagParams params = computeDagParams(m_epochContext);
+        axiMutex.lock();
+        SQRLAXIWrite(m_axi, params.nItems, 0x5040, true);
+        SQRLAXIWrite(m_axi, params.rnItems, 0x5088, true);
+        // Power off DAGGEN
+        SQRLAXIWrite(m_axi, 0x0, 0xB000, true);
+        axiMutex.unlock();
+        sqrllog << "Warm attach: reusing Epoch " << m_warmEpoch << " DAG, clock and intensity";
+        m_dagInvalid = false;
+        return true;
+      }
+      sqrllog << "Warm attach: Epoch changed to " << m_epochContext.epochNumber << ", reinitializing";
+    }
+
     m_dagging = true;   
     // Always drop to stock clock immediately on start, before we stop or change cores
     setClock(-2);
@@ -498,15 +656,23 @@ bool SQRLMiner::initEpoch_internal()
 
     uint8_t err = 0;
 
-    // Compute and set mining parameters always (DAG may be generated, but core may have been reset)
-    uint32_t nItems = m_epochContext.dagSize/128;
-    err = SQRLAXIWrite(m_axi, nItems, 0x5040, true);
+    // Use the parameters pre-staged for this epoch if we got them ahead of time
+    SQRLDagParams params;
+    {
+      std::lock_guard<std::mutex> l(m_prestageMutex);
+      if (m_prestaged.epoch == m_epochContext.epochNumber)
+        params = m_prestaged;
+    }
+    if (params.epoch != m_epochContext.epochNumber)
+      params = computeDagParams(m_epochContext);
+    else
+      sqrllog << "Using pre-staged parameters for Epoch " << params.epoch;
+
+    // Set mining parameters always (DAG may be generated, but core may have been reset)
+    err = SQRLAXIWrite(m_axi, params.nItems, 0x5040, true);
     if (err != 0) sqrllog << "Failed setting ethcore nItems";
 
-    // Compute the reciprical, adjusted to ETH optimized modulo
-    double reciprical = 1.0/(double)nItems * 0x1000000000000000ULL;
-    uint32_t intR = (uint64_t)reciprical >> 4ULL;
-    err = SQRLAXIWrite(m_axi, intR, 0x5088, true);
+    err = SQRLAXIWrite(m_axi, params.rnItems, 0x5088, true);
     if (err != 0) sqrllog << "Failed setting ethcore rnItems!";
 
     // Check for the existing DAG
@@ -519,16 +685,23 @@ bool SQRLMiner::initEpoch_internal()
     if ((dagStatusWord >> 31) && !m_settings.forceDAG) {
       sqrllog << "Current HW DAG is for Epoch " << (dagStatusWord & 0xFFFF);
       if ( (dagStatusWord & 0xFFFF) == (uint32_t)m_epochContext.epochNumber) {
-        sqrllog << "No DAG Generation is needed";
-	// Power off DAGGEN
-	SQRLAXIWrite(m_axi, 0x0, 0xB000, true);
-	m_dagging = false;
-	axiMutex.unlock();
-	setClock(m_lastClk);
-
-    m_tuner->startTune(m_lastClk);
-
-	return true;
+        // Past the failure limit, or with too little read back, the DAG is kept as it is
+        m_dagInvalid = false;
+        if (m_settings.dagVerifySamples == 0 || checkDAG() || !m_dagInvalid) {
+          sqrllog << "No DAG Generation is needed";
+          // Power off DAGGEN
+          SQRLAXIWrite(m_axi, 0x0, 0xB000, true);
+          m_dagging = false;
+          m_dagInvalid = false;
+          axiMutex.unlock();
+          setClock(m_lastClk);
+
+          m_tuner->startTune(m_lastClk);
+          saveDeviceState();
+
+          return true;
+        }
+        sqrllog << EthRed << "Existing DAG failed verification, regenerating";
       }
     }
 
@@ -547,34 +720,33 @@ bool SQRLMiner::initEpoch_internal()
     }
 
     // Newer-bitstreams support on-module cache generation
-    const bool makeCacheOnChip = true;
-    uint32_t num_parent_nodes = m_epochContext.lightSize/64;
+    const bool makeCacheOnChip = m_caps.cacheOnChip;
+    uint32_t num_parent_nodes = params.numParentNodes;
     if (makeCacheOnChip) {
       sqrllog << "Generating LightCache...";
       auto startCache = std::chrono::steady_clock::now(); 
       SQRLAXIWrite(m_axi, 0x2, 0x40BC, true);
       SQRLAXIWrite(m_axi, num_parent_nodes, 0x4008, true);
       // Set seedhash (reverse byte order)
-      uint8_t revSeed[32];
-      uint8_t * newSeed = (uint8_t *)&m_epochContext.seed;
-      for(int s=0; s < 32; s++) revSeed[s] = newSeed[31-s];
-      //for(int s=0;s<32;s++) printf("%02hhx", revSeed[s]);
-      //  printf("\n");
-      SQRLAXIWriteBulk(m_axi, revSeed, 32, 0x40c0, 1/*EndianFlip*/);
+      SQRLAXIWriteBulk(m_axi, params.revSeed, 32, 0x40c0, 1/*EndianFlip*/);
+      m_dagPhase = SQRLDagPhase::LightCache;
       SQRLAXIWrite(m_axi, 0x1, 0x40BC, true);
       uint32_t cstatus = 0;
       while ((cstatus&2) != 0x2) {
-	axiMutex.unlock();
-#ifdef _WIN32
-        Sleep(100);
-#else
-        usleep(100000);
-#endif
-	axiMutex.lock();
+        // Wakes on the completion interrupt, or polls every 100ms on older bitstreams
+        waitForDaggenInterrupt(100);
         err = SQRLAXIRead(m_axi, &cstatus, 0x40BC);
         if((err != 0) && m_settings.dieOnError) {
           exit(1);
         }
+        if (err == 0)
+          heartbeat();
+        if (shouldStop()) {
+          m_dagging = false;
+          m_dagPhase = SQRLDagPhase::Idle;
+          axiMutex.unlock();
+          return false;
+        }
       }
       auto cacheTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startCache);
       sqrllog << "Final LightCache Generation Status: " << cstatus;
@@ -608,28 +780,21 @@ bool SQRLMiner::initEpoch_internal()
       }
       if (uploadFailed) {
         m_dagging = false;
+        m_dagPhase = SQRLDagPhase::Idle;
 	axiMutex.unlock();
         return false;
       }
     }
     sqrllog << "Preparing new DAG Generator Parameters...";
     sqrllog << "NUM_PARENT_NODES = " << num_parent_nodes;
-    uint32_t num_mixers=m_settings.dagMixers; // This is fixed at bitstream gen time, added only for convience
-    sqrllog << "NUM_MIXERS = "<< num_mixers;
-    uint32_t mixer_size = m_epochContext.dagSize/64/num_mixers;
-    uint32_t leftover = (m_epochContext.dagSize/64 - mixer_size*num_mixers);
-    sqrllog << "DAG_ITEMS_PER_MIXER = " << mixer_size;
-    sqrllog << "DAG_ITEMS_LEFTOVER = " << leftover;
+    sqrllog << "NUM_MIXERS = "<< params.mixers.size();
+    sqrllog << "DAG_ITEMS_PER_MIXER = " << params.mixerSize;
+    sqrllog << "DAG_ITEMS_LEFTOVER = " << params.mixerLeftover;
 
     SQRLAXIWrite(m_axi, num_parent_nodes, 0x4008, true);
-    uint32_t dagPos=0;
-    for(uint32_t i=0; i < num_mixers; i++) {
-      uint32_t mixer_start  = dagPos;
-      SQRLAXIWrite(m_axi, mixer_start, 0x400c + 8*i, true);
-      uint32_t mixer_end = dagPos+mixer_size;
-      if (i == 0) mixer_end += leftover;
-      SQRLAXIWrite(m_axi, mixer_end, 0x4010 + 8*i, true);
-      dagPos = mixer_end;
+    for(uint32_t i=0; i < params.mixers.size(); i++) {
+      SQRLAXIWrite(m_axi, params.mixers[i].first, 0x400c + 8*i, true);
+      SQRLAXIWrite(m_axi, params.mixers[i].second, 0x4010 + 8*i, true);
     }
 
     // Finally, kick off DAG generation
@@ -641,29 +806,38 @@ bool SQRLMiner::initEpoch_internal()
     if (err != 0) {
       sqrllog << "Error checking DAG status";
     } 
-    uint8_t cnt = 0;
+    m_dagPhase = SQRLDagPhase::DAG;
+    m_dagProgress = 0;
     if (!m_settings.skipDAG) {
+      auto lastReport = std::chrono::steady_clock::now();
       while ((status&2) != 0x2) {
-        axiMutex.unlock();
-#ifdef _WIN32
-        Sleep(1000);
-#else
-        usleep(1000000);
-#endif
-        axiMutex.lock();
+        // Wakes on the completion interrupt, or polls every second on older bitstreams
+        bool interrupted = waitForDaggenInterrupt(1000);
         err = SQRLAXIRead(m_axi, &status, 0x4000);
         if((err != 0) && m_settings.dieOnError) {
           exit(1);
         }
-        cnt++;
-        if (cnt % 5 == 0) {
-	  uint32_t dagProgress = 0;
-	  SQRLAXIRead(m_axi, &dagProgress, 0x4008);
-	  double progress = (double)(mixer_size+leftover);
-  	  progress = (double)dagProgress / progress;
-          sqrllog << EthPurple << "DAG " << std::fixed << std::setprecision(2) << (progress * 100.0) << "%" << EthReset; 
+        if (err == 0)
+          heartbeat();
+        if (shouldStop()) {
+          m_dagging = false;
+          m_dagPhase = SQRLDagPhase::Idle;
+          axiMutex.unlock();
+          return false;
+        }
+        if (interrupted || ((status&2) == 0x2))
+          continue;
+        uint32_t dagProgress = 0;
+        if (SQRLAXIRead(m_axi, &dagProgress, 0x4008) == SQRLAXIResultOK) {
+          double progress = (double)(params.mixerSize+params.mixerLeftover);
+          m_dagProgress = ((double)dagProgress / progress) * 100.0;
+        }
+        if (std::chrono::steady_clock::now() - lastReport >= std::chrono::seconds(5)) {
+          sqrllog << EthPurple << "DAG " << std::fixed << std::setprecision(2) << (double)m_dagProgress << "%" << EthReset; 
+          lastReport = std::chrono::steady_clock::now();
         }
       }
+      m_dagProgress = 100.0;
     } else {
       sqrllog << "DEV - Skipping DAG, expect failed hashes";
     }
@@ -674,8 +848,11 @@ bool SQRLMiner::initEpoch_internal()
               << dagTime.count() << " ms."; 
 
     sqrllog << "Duplicating DAG Items for performance...";
+    m_dagPhase = SQRLDagPhase::Duplicate;
+    m_dagProgress = 0;
     auto startSwizzle = std::chrono::steady_clock::now(); 
     for(uint64_t i=0; i < 256; i++) {
+      m_dagProgress = (double)i / 256.0 * 100.0;
       uint64_t src = 0x100000000ULL | (i << 24);
       uint64_t dst = 0x0ULL | (((i&0x0f) << 4) | ((i&0xF0) >> 4)) << 24;
       //printf("Swizzling chunk from %016lx to %016lx\n", src, dst);
@@ -701,6 +878,13 @@ bool SQRLMiner::initEpoch_internal()
     // Preserve the status to avoid the work in the future
     SQRLAXIWrite(m_axi, (1 << 31) | (uint32_t)m_epochContext.epochNumber, 0x40B8, true);	
     m_dagging = false;
+    m_dagPhase = SQRLDagPhase::Idle;
+    m_dagInvalid = false;
+
+    // Sample the fresh DAG - invalidates the status above on failure
+    if (m_settings.dagVerifySamples && !m_settings.skipDAG) {
+      checkDAG();
+    }
 
     sqrllog << "Putting DAG Generator in low power mode...";
     SQRLAXIWrite(m_axi, 0x0, 0xB000, true);
@@ -713,10 +897,514 @@ bool SQRLMiner::initEpoch_internal()
     axiMutex.unlock();
 
     m_tuner->startTune(m_lastClk);
+    if (!m_dagInvalid)
+      saveDeviceState();
+
+    return true;
+}
+
+
+/*
+ * Derives the DAGGEN and hashcore parameters of an epoch.
+ * Host-only work, safe to run ahead of time from the pre-staging thread
+ */
+SQRLDagParams SQRLMiner::computeDagParams(EpochContext const& _ec)
+{
+    SQRLDagParams params;
+    params.epoch = _ec.epochNumber;
+    params.nItems = _ec.dagSize/128;
+
+    // Compute the reciprical, adjusted to ETH optimized modulo
+    double reciprical = 1.0/(double)params.nItems * 0x1000000000000000ULL;
+    params.rnItems = (uint64_t)reciprical >> 4ULL;
+
+    params.numParentNodes = _ec.lightSize/64;
+    uint8_t * newSeed = (uint8_t *)&_ec.seed;
+    for(int s=0; s < 32; s++) params.revSeed[s] = newSeed[31-s];
+
+    // Mixer count is fixed at bitstream gen time, added only for convience
+    uint32_t num_mixers = m_settings.dagMixers ? m_settings.dagMixers : m_caps.dagMixers;
+    params.mixerSize = _ec.dagSize/64/num_mixers;
+    params.mixerLeftover = (_ec.dagSize/64 - params.mixerSize*num_mixers);
+    uint32_t dagPos = 0;
+    for(uint32_t i=0; i < num_mixers; i++) {
+      uint32_t mixer_end = dagPos+params.mixerSize;
+      if (i == 0) mixer_end += params.mixerLeftover;
+      params.mixers.emplace_back(dagPos, mixer_end);
+      dagPos = mixer_end;
+    }
+    return params;
+}
+
+/*
+ * Called ahead of an epoch switch so initEpoch_internal only has to program the board
+ */
+void SQRLMiner::prestageEpoch(EpochContext const& _ec)
+{
+    SQRLDagParams params = computeDagParams(_ec);
+    std::lock_guard<std::mutex> l(m_prestageMutex);
+    m_prestaged = params;
+    sqrllog << "Pre-staged DAG parameters for Epoch " << _ec.epochNumber;
+}
+
+/*
+ * Checks the HW DAG status word - lets the DAG load scheduler skip boards
+ * which already hold the requested epoch
+ */
+bool SQRLMiner::isDagReady(int epoch)
+{
+    if (m_settings.forceDAG || m_dagInvalid || m_axi == NULL)
+        return false;
+    uint32_t dagStatusWord = 0;
+    axiMutex.lock();
+    SQRLAXIResult err = SQRLAXIRead(m_axi, &dagStatusWord, 0x40B8);
+    axiMutex.unlock();
+    if (err != SQRLAXIResultOK)
+        return false;
+    return (dagStatusWord >> 31) && ((dagStatusWord & 0xFFFF) == (uint32_t)epoch);
+}
+
+bool SQRLMiner::loadDeviceState(SQRLDeviceState& state)
+{
+    return !m_deviceKey.empty() && stateStore().find(m_deviceKey, state);
+}
+
+/*
+ * Records the configuration the board is left in
+ */
+void SQRLMiner::saveDeviceState()
+{
+    int epoch = m_epochContext.epochNumber;
+    double clock = (int)m_lastClk;
+    SQSettings settings = m_settings;
+    bool saved = stateStore().update(m_deviceKey, [&](SQRLDeviceState& state) {
+        state.epoch = epoch;
+        state.clock = clock;
+        state.patience = settings.patience;
+        state.intensityN = settings.intensityN;
+        state.intensityD = settings.intensityD;
+        state.fkVCCINT = settings.fkVCCINT;
+        state.jcVCCINT = settings.jcVCCINT;
+    });
+    if (!saved && !m_deviceKey.empty())
+        sqrllog << EthRed << "Could not write state file!";
+}
+
+/*
+ * Records a finished tune, reused by later runs at the same voltages
+ */
+void SQRLMiner::saveTunedState(double clock, unsigned patience, unsigned intensityN,
+    unsigned intensityD, unsigned fkVout, unsigned jcVout)
+{
+    unsigned fkVCCINT = m_settings.fkVCCINT;
+    unsigned jcVCCINT = m_settings.jcVCCINT;
+    bool saved = stateStore().update(m_deviceKey, [&](SQRLDeviceState& state) {
+        state.tunedClock = clock;
+        state.tunedPatience = patience;
+        state.tunedIntensityN = intensityN;
+        state.tunedIntensityD = intensityD;
+        state.tunedFkVCCINT = fkVCCINT;
+        state.tunedJcVCCINT = jcVCCINT;
+        state.tunedFkVout = fkVout;
+        state.tunedJcVout = jcVout;
+    });
+    if (!saved && !m_deviceKey.empty())
+        sqrllog << EthRed << "Could not write state file!";
+}
+
+/*
+ * Adds share outcomes and failures since the last call to the board's history.
+ * The clock counts as good once the error rate over the window is surely
+ * below the 3% the tuner accepts
+ */
+void SQRLMiner::saveHistory()
+{
+    if (m_deviceKey.empty())
+        return;
+
+    auto solutions = Farm::f().getSolutions(m_index);
+    unsigned good = solutions.accepted + solutions.low;
+    // Counters only go down if someone else reset them
+    if (good < m_savedGood || solutions.failed < m_savedFailed)
+    {
+        m_savedGood = good;
+        m_savedFailed = solutions.failed;
+    }
+    unsigned newGood = good - m_savedGood;
+    unsigned newFailed = solutions.failed - m_savedFailed;
+
+    auto& errors = m_tuner->getErrorEstimator();
+    bool clockGood = errors.windowSamples() >= 100 && errors.windowUpper() < 0.03;
+    double clock = (int)m_lastClk;
+    unsigned fkVCCINT = m_settings.fkVCCINT;
+    unsigned jcVCCINT = m_settings.jcVCCINT;
+    unsigned stallResets = m_pendingStallResets;
+    unsigned dagFailures = m_pendingDagFailures;
+
+    bool saved = stateStore().update(m_deviceKey, [&](SQRLDeviceState& state) {
+        state.goodShares += newGood;
+        state.failedShares += newFailed;
+        state.stallResets += stallResets;
+        state.dagFailures += dagFailures;
+        if (clockGood)
+        {
+            state.goodClock = clock;
+            state.goodFkVCCINT = fkVCCINT;
+            state.goodJcVCCINT = jcVCCINT;
+        }
+    });
+    if (!saved)
+    {
+        sqrllog << EthRed << "Could not write state file!";
+        return;
+    }
+    m_savedGood = good;
+    m_savedFailed = solutions.failed;
+    m_pendingStallResets = 0;
+    m_pendingDagFailures = 0;
+    m_lastHistorySave = std::chrono::steady_clock::now();
+}
 
+/*
+ * Checks whether the board is still configured as the persisted record says -
+ * DAG present for the recorded epoch and clock unchanged. Restores the recorded
+ * intensity and skips tuning if so
+ */
+bool SQRLMiner::tryWarmAttach()
+{
+    SQRLDeviceState state;
+    if (!loadDeviceState(state)) {
+      sqrllog << "Warm attach: no state recorded for " << m_deviceKey;
+      return false;
+    }
+    if (state.fkVCCINT != m_settings.fkVCCINT || state.jcVCCINT != m_settings.jcVCCINT) {
+      sqrllog << "Warm attach: VCCINT settings changed";
+      return false;
+    }
+    if (m_deviceDescriptor.targetClk != 0 && (int)m_deviceDescriptor.targetClk != (int)state.clock) {
+      sqrllog << "Warm attach: target clock changed";
+      return false;
+    }
+
+    uint32_t dagStatusWord = 0;
+    if (SQRLAXIRead(m_axi, &dagStatusWord, 0x40B8) != SQRLAXIResultOK || !(dagStatusWord >> 31) ||
+        (dagStatusWord & 0xFFFF) != (uint32_t)state.epoch) {
+      sqrllog << "Warm attach: HW DAG does not match Epoch " << state.epoch;
+      return false;
+    }
+
+    double clk = getClock();
+    if (fabs(clk - state.clock) > 1.0) {
+      sqrllog << "Warm attach: clock " << clk << " differs from recorded " << state.clock;
+      return false;
+    }
+
+    m_warmAttach = true;
+    m_warmEpoch = state.epoch;
+    m_lastClk = state.clock;
+    m_settings.patience = state.patience;
+    m_settings.intensityN = state.intensityN;
+    m_settings.intensityD = state.intensityD;
+    // The recorded configuration is already tuned
+    m_settings.autoTune = 0;
     return true;
 }
 
+/*
+ * Target the core reports health shares against. With a configured share rate
+ * it follows the measured hashrate, so verification load stays the same however
+ * fast the board runs
+ */
+h256 SQRLMiner::healthTarget()
+{
+    // Fixed - one share per 2^27 hashes
+    uint64_t top = 0x0000001fffffffffULL;
+
+    if (m_settings.healthShareRate > 0)
+    {
+        double hashRate = hashRateStats().ewma();
+        if (hashRate <= 0)
+            hashRate = expectedHashRate();
+        if (hashRate > 0)
+        {
+            // Odds per hash, between one in 2^20 and one in 2^40
+            double p = m_settings.healthShareRate / hashRate;
+            p = std::max(pow(2.0, -40), std::min(pow(2.0, -20), p));
+            top = (uint64_t)(p * pow(2.0, 64)) - 1;
+        }
+    }
+
+    h256 target;
+    for (int b = 0; b < 32; b++)
+        target[b] = (b < 8) ? (uint8_t)(top >> (56 - 8 * b)) : 0xff;
+    return target;
+}
+
+/*
+ * Board input and VCCINT rail power from the JCM regulator over PMBus, called
+ * from the search loop without axiMutex. Boards without one (FK) stop being
+ * asked after a few misses
+ */
+void SQRLMiner::readBoardPower()
+{
+  std::lock_guard<std::mutex> l(iicMutex);
+  if (m_pmbusMisses >= 3)
+    return;
+
+  const uint8_t acadia = ACADIA_ADDR;
+  SQRLIIC jc(m_axi, SQRL_IIC_JC, 0);
+  double pin = 0, pout = 0, vout = 0, iout = 0;
+  bool any = false;
+  // The readings are paged - without VCCINT selected they may be another rail
+  if (jc.selectPage(acadia, ACADIA_LOOP_VCCINT) == SQRLAXIResultOK) {
+    if (jc.readLinear11(acadia, PMBUS_READ_PIN, pin) == SQRLAXIResultOK)
+      any = true;
+    if (jc.readLinear11(acadia, PMBUS_READ_POUT, pout) == SQRLAXIResultOK) {
+      any = true;
+    } else if (jc.readVout(acadia, vout) == SQRLAXIResultOK &&
+               jc.readLinear11(acadia, PMBUS_READ_IOUT, iout) == SQRLAXIResultOK) {
+      any = true;
+      pout = vout * iout;
+    }
+  }
+
+  if (!any) {
+    if (++m_pmbusMisses >= 3)
+      sqrllog << "sqrl-" << m_index << " No PMBus regulator answering, power not reported";
+    m_inputPower = 0;
+    m_railPower = 0;
+    return;
+  }
+  m_pmbusMisses = 0;
+  m_inputPower = pin;
+  m_railPower = pout;
+}
+
+/*
+ * Hashrate this board should reach after the DAG load - measured if known,
+ * else modelled from clock and intensity throughput as the tuner does
+ */
+float SQRLMiner::expectedHashRate()
+{
+    double avg10min = hashRateStats().mean(HashRateStats::Min10);
+    if (avg10min > 0)
+        return avg10min;
+    return (m_lastClk / 8) * getThroughput() * pow(10, 6);
+}
+
+/*
+ * Measured draw, input side if the board reports it. Boards without PMBus get
+ * a rough model of the VU35P - static draw plus a part growing with clock and
+ * throughput
+ */
+double SQRLMiner::boardPower()
+{
+  if (m_inputPower > 0)
+    return m_inputPower;
+  if (m_railPower > 0)
+    return m_railPower;
+  return sqrlStaticWatts + sqrlWattsPerMHz * m_lastClk * getThroughput();
+}
+
+void SQRLMiner::setPowerLimit(float watts)
+{
+  double last = m_governor->getPowerLimit();
+  if ((watts > 0) != (last > 0) || fabs(watts - last) >= 10)
+    sqrllog << "Power limit " << (watts > 0 ? to_string((int)watts) + "W" : string("lifted"));
+  m_governor->setPowerLimit(watts);
+}
+
+/*
+ * What the board would draw at the configured intensity and the clock it had
+ * before any governor step - the dynamic part of the current draw scaled back
+ * up. 0 while it is not hashing, its draw is then not ours to limit
+ */
+float SQRLMiner::powerDemand()
+{
+  double power = boardPower();
+  double clk = m_lastClk;
+  if (m_dagging || power <= 0 || clk <= 0 || (m_tuner != NULL && m_tuner->isTuning()))
+    return 0;
+
+  double baseClock = m_governor->getBaseClock() > 0 ? m_governor->getBaseClock() : clk;
+  double baseThroughput = m_settings.intensityN != 0 ?
+      (double)m_settings.intensityN / (m_settings.intensityN + m_settings.intensityD) : 1.0;
+  double now = clk * getThroughput();
+  double staticPower = std::min(power, sqrlStaticWatts);
+  return staticPower + (power - staticPower) * (baseClock * baseThroughput) / now;
+}
+
+/*
+ * Fraction of cycles the hashcore searches at the programmed intensity, thermal
+ * derate included
+ */
+float SQRLMiner::getThroughput()
+{
+    unsigned n, d;
+    m_governor->effectiveIntensity(m_settings.intensityN, m_settings.intensityD, n, d);
+    return n ? (float)n / (n + d) : 1.0f;
+}
+
+/*
+ * Waits up to timeoutMs for the DAGGEN completion interrupt (LightCache or DAG done).
+ * Must be called with axiMutex held, which is released for the duration of the wait.
+ * Bitstreams that do not raise the interrupt simply time out, which degrades to the
+ * legacy fixed-interval polling.  Returns true if the interrupt fired.
+ */
+bool SQRLMiner::waitForDaggenInterrupt(uint32_t timeoutMs)
+{
+    uint64_t interruptData;
+    axiMutex.unlock();
+    SQRLAXIResult res = SQRLAXIWaitForInterrupt(m_axi, SQRL_DAGGEN_INTERRUPT, &interruptData, timeoutMs);
+    axiMutex.lock();
+    return (res == SQRLAXIResultOK);
+}
+
+/*
+ * Reads back random 128 byte DAG items from both HBM stacks and compares them
+ * with items computed on the host.  Must be called with axiMutex held, which is
+ * released between item reads so telemetry and kicks are not held off for the sample.
+ * Returns a mask of stacks holding mismatched items (bit 0 = stack 0, bit 1 = stack 1),
+ * or dagVerifyUnread if most items could not be read back at all
+ */
+uint8_t SQRLMiner::verifyDAG(unsigned samples)
+{
+    // The context m_epochContext was made from - pre-staged, else the global one
+    auto prepared = EthashAux::findEpoch(m_epochContext.epochNumber);
+    const auto& context =
+        prepared ? *prepared : ethash::get_global_epoch_context(m_epochContext.epochNumber);
+    uint32_t numItems = (uint32_t)(m_epochContext.dagSize / 128);
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<uint32_t> dist(0, numItems - 1);
+    vector<uint32_t> items(samples);
+    for (auto& item : items)
+        item = dist(gen);
+
+    // Compute the reference items across all cores while we read back the device
+    vector<ethash::hash1024> expected(samples);
+    std::atomic<unsigned> next = {0};
+    unsigned numThreads = std::max(1U, std::min(std::thread::hardware_concurrency(), samples));
+    vector<std::thread> pool;
+    for (unsigned t = 0; t < numThreads; t++)
+    {
+        pool.emplace_back([&]() {
+            unsigned i;
+            while ((i = next++) < samples)
+                expected[i] = ethash::calculate_dataset_item_1024(context, items[i]);
+        });
+    }
+
+    vector<uint8_t> readback(samples * 2 * 128);
+    vector<bool> readOk(samples * 2, false);
+    axiMutex.unlock();
+    for (unsigned i = 0; i < samples; i++)
+    {
+        for (unsigned stack = 0; stack < 2; stack++)
+        {
+            uint64_t addr = dagItemAddress(items[i]) + (stack ? 0x100000000ULL : 0x0ULL);
+            axiMutex.lock();
+            readOk[i * 2 + stack] = (SQRLAXICDMAReadBytes(m_axi, &readback[(i * 2 + stack) * 128],
+                                         128, addr) == SQRLAXIResultOK);
+            axiMutex.unlock();
+        }
+    }
+    axiMutex.lock();
+    for (auto& t : pool)
+        t.join();
+
+    // Mismatches by stack and 16MB region
+    uint8_t badStacks = 0;
+    unsigned unread = 0;
+    std::map<uint64_t, unsigned> badRegions;
+    for (unsigned i = 0; i < samples; i++)
+    {
+        for (unsigned stack = 0; stack < 2; stack++)
+        {
+            if (!readOk[i * 2 + stack])
+            {
+                unread++;
+                continue;
+            }
+            if (memcmp(&readback[(i * 2 + stack) * 128], expected[i].bytes, 128) != 0)
+            {
+                uint64_t addr = dagItemAddress(items[i]) + (stack ? 0x100000000ULL : 0x0ULL);
+                badRegions[addr & ~0xFFFFFFULL]++;
+                badStacks |= (1 << stack);
+            }
+        }
+    }
+
+    if (unread)
+        sqrllog << EthOrange << "DAG Verify: " << unread << " items could not be read back";
+    if (unread > samples)  // Over half of the 2 * samples reads
+        return dagVerifyUnread;
+    for (auto const& region : badRegions)
+    {
+        sqrllog << EthRed << "DAG Verify: " << region.second << " bad items in HBM stack "
+                << (region.first >> 32) << " region " << toHex(region.first, HexPrefix::Add);
+    }
+    return badStacks;
+}
+
+/*
+ * Verifies the DAG, repairing a single bad HBM stack from its good twin.
+ * If both stacks are bad the DAG status is invalidated so the next
+ * work package regenerates it.  True only if the sample passed - a failure
+ * past the retry limit or an unreadable sample leaves m_dagInvalid clear and
+ * the DAG in place.  Must be called with axiMutex held.
+ */
+bool SQRLMiner::checkDAG()
+{
+    auto start = std::chrono::steady_clock::now();
+    uint8_t badStacks = verifyDAG(m_settings.dagVerifySamples);
+    m_lastDagVerify = std::chrono::steady_clock::now();
+
+    if (badStacks == dagVerifyUnread)
+    {
+        sqrllog << EthOrange << "DAG Verify: inconclusive, most items could not be read back";
+        return false;
+    }
+
+    if (badStacks == 0x1 || badStacks == 0x2)
+    {
+        uint64_t src = (badStacks == 0x1) ? 0x100000000ULL : 0x0ULL;
+        uint64_t dst = (badStacks == 0x1) ? 0x0ULL : 0x100000000ULL;
+        sqrllog << EthOrange << "DAG Verify: Restoring HBM stack " << (dst >> 32)
+                << " from stack " << (src >> 32);
+        if (SQRLAXICDMACopyBytes(m_axi, src, dst, 4ULL * 1024ULL * 1024ULL * 1024ULL) == 0)
+            badStacks = verifyDAG(m_settings.dagVerifySamples);
+        if (badStacks == dagVerifyUnread)
+        {
+            sqrllog << EthOrange << "DAG Verify: inconclusive after restoring, most items could "
+                                    "not be read back";
+            return false;
+        }
+    }
+
+    auto verifyTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    if (badStacks == 0)
+    {
+        sqrllog << "DAG Verify: " << m_settings.dagVerifySamples << " items per stack OK in "
+                << verifyTime.count() << " ms.";
+        m_dagVerifyFailures = 0;
+        return true;
+    }
+
+    m_pendingDagFailures++;
+    if (++m_dagVerifyFailures > 3)
+    {
+        sqrllog << EthRed << "DAG keeps failing verification - check HBM, not regenerating";
+        return false;
+    }
+    sqrllog << EthRed << "DAG Verify failed - forcing regeneration";
+    SQRLAXIWrite(m_axi, 0x0, 0x40B8, true);
+    m_dagInvalid = true;
+    return false;
+}
 
 /*
    Miner should stop working on the current block
@@ -729,7 +1417,7 @@ void SQRLMiner::kick_miner()
 {
     m_new_work.store(true, std::memory_order_relaxed);
     // Just put the core in reset
-    if (!m_dagging) {
+    if (!m_dagging && m_axi != NULL) {  // NULL if the connect failed or timed out
       // This can happen on odd thread
       // Stop mining if we are mining
       //StopHashcore(true); - happens in search exit
@@ -746,18 +1434,26 @@ void SQRLMiner::search(const dev::eth::WorkPackage& w)
     //const auto& context = ethash::get_global_epoch_context(w.epoch);
     //const auto header = ethash::hash256_from_bytes(w.header.data());
     //const auto boundary = ethash::hash256_from_bytes(w.boundary.data());
-    auto nonce = w.startNonce;
+
+    // Skip the part of the segment already hashed for this job before a stall reset or pause
+    auto nonce = resumeNonce(w);
+    const uint64_t searchStart = nonce;
 
     
 
     m_new_work.store(false, std::memory_order_relaxed);
 
+    if (w.header != m_submittedHeader) {
+      m_submittedHeader = w.header;
+      m_submitted.clear();
+    }
+
     // Re-init parameters 
     axiMutex.lock();
     uint8_t err = 0;
     err = SQRLAXIWriteBulk(m_axi, (uint8_t *)w.header.data(), 32, 0x5000, 1); 
     if (err != 0) sqrllog << "Failed setting ethcore header";
-    auto falseTarget = h256("0x0000001fffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+    auto falseTarget = healthTarget();
     if (w.boundary > falseTarget) falseTarget = w.boundary;
     err = SQRLAXIWriteBulk(m_axi, (uint8_t*)falseTarget.data(), 32, 0x5020, 1);
     if (err != 0) sqrllog << "Failed setting ethcore target";
@@ -782,10 +1478,13 @@ void SQRLMiner::search(const dev::eth::WorkPackage& w)
     {
         flags |= (1 << 6) | ((m_settings.patience & 0xff) << 8); 
     }
-    if (m_settings.intensityN != 0)
+    // Configured or tuned intensity, less what the thermal governor takes off
+    unsigned intensityN, intensityD;
+    m_governor->effectiveIntensity(m_settings.intensityN, m_settings.intensityD, intensityN, intensityD);
+    if (intensityN != 0)
     {
-        flags |= (1 << 0) | ((m_settings.intensityN & 0xFF) << 24);
-        flags |= (((m_settings.intensityD & 0x3F) * 8 - 1) << 16);
+        flags |= (1 << 0) | ((intensityN & 0xFF) << 24);
+        flags |= (((intensityD & 0x3F) * 8 - 1) << 16);
     }
     err = SQRLAXIWrite(m_axi, flags, 0x5080, false);
     if (err != 0) {
@@ -803,13 +1502,22 @@ void SQRLMiner::search(const dev::eth::WorkPackage& w)
     //} 
     
     // Bit 0 = enable nonces via interrupt instead of polling
-    SQRLAXIWrite(m_axi, 0x00010001, 0x506c, false);
+    err = SQRLAXIWrite(m_axi, m_caps.nonceInterrupts ? 0x00010001 : 0x00010000, 0x506c, false);
     if (err != 0) {
       sqrllog << "Error starting hashcore";
     }
 
     uint32_t lastSCnt = 0;
     uint64_t lastTChecks = 0;
+
+    // Odds of a single hash meeting the target the core reports nonces against
+    double nonceProbability = 0;
+    for (int b=0; b < 8; b++) nonceProbability = nonceProbability*256.0 + falseTarget[b];
+    nonceProbability /= pow(2.0, 64);
+
+    // Status counters are polled on their own cadence, nonce interrupts wake us in between
+    auto nextStatus = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_settings.statusInterval);
+    auto lastPoll = std::chrono::steady_clock::now();
     while (true)
     {
         if (m_new_work.load(std::memory_order_relaxed))  // new work arrived ?
@@ -824,10 +1532,16 @@ void SQRLMiner::search(const dev::eth::WorkPackage& w)
 	//   auto r = ethash::search(context, header, boundary, nonce, blocksize);
 	axiMutex.unlock();
 
+	if (std::chrono::steady_clock::now() - m_lastPowerRead >= std::chrono::milliseconds(powerReadIntervalMs)) {
+	  m_lastPowerRead = std::chrono::steady_clock::now();
+	  readBoardPower();
+	}
+
 	bool nonceValid[4] = {false,false,false,false};
 	uint64_t nonce[4] = {0,0,0,0};
+	vector<uint64_t> nonces;
 
-	if (0/*Legacy Mode*/) {
+	if (!m_caps.nonceInterrupts) {
 	  // LEGACY - polling based
 #ifdef _WIN32
 	  Sleep(m_settings.workDelay/1000); // Give a momment for solutions
@@ -874,13 +1588,22 @@ void SQRLMiner::search(const dev::eth::WorkPackage& w)
         } else {
           // Modern, interrupt
 	  uint64_t interruptNonce;
-          SQRLAXIResult axiRes = SQRLAXIWaitForInterrupt(m_axi, (1<<0), &interruptNonce,m_settings.workDelay/1000);  	
+	  // Wait about as long as the next nonce is expected to take, bounded by the next status poll
+	  uint32_t waitMs = m_settings.workDelay/1000;
+	  double expectedHps = expectedHashRate();
+	  if (expectedHps > 0 && nonceProbability > 0) {
+	    double untilStatusMs = std::chrono::duration_cast<std::chrono::milliseconds>(nextStatus - std::chrono::steady_clock::now()).count();
+	    double nonceIntervalMs = 1000.0 / (expectedHps * nonceProbability);
+	    waitMs = std::max(waitMs, (uint32_t)std::max(0.0, std::min(nonceIntervalMs, untilStatusMs)));
+	  }
+          SQRLAXIResult axiRes = SQRLAXIWaitForInterrupt(m_axi, SQRL_NONCE_INTERRUPT, &interruptNonce, waitMs);  	
 	  if (axiRes == SQRLAXIResultOK) {
-            nonceValid[0] = true;
-	    nonce[0] = interruptNonce;  
+	    nonces.push_back(interruptNonce);
+	    // Drain anything else already queued without blocking again
+	    while (SQRLAXIWaitForInterrupt(m_axi, SQRL_NONCE_INTERRUPT, &interruptNonce, 0) == SQRLAXIResultOK)
+	      nonces.push_back(interruptNonce);
 	  } else if (axiRes == SQRLAXIResultTimedOut) {
             // Normal
-	    nonceValid[0] = false;
 	  } else {
 	    sqrllog << EthRed << "FPGA Interrupt Error";
 	    if(m_settings.dieOnError) {
@@ -888,8 +1611,57 @@ void SQRLMiner::search(const dev::eth::WorkPackage& w)
 	    }
   	  }
 	  axiMutex.lock();
+
+	  // Results which did not raise an interrupt still sit in the slots, checked
+	  // along with results that did and on status polls
+	  uint32_t value = 0;
+	  if ((!nonces.empty() || std::chrono::steady_clock::now() >= nextStatus) &&
+	      SQRLAXIRead(m_axi, &value, 0x506c) == SQRLAXIResultOK && ((value >> 12) & 0xF)) {
+	    for (unsigned i=0; i < m_caps.nonceSlots; i++) {
+	      if ((value >> (15-i)) & 0x1) {
+	        uint32_t nonceLo,nonceHi;
+	        if ((SQRLAXIRead(m_axi, &nonceHi, 0x5000+(19+i)*4) == SQRLAXIResultOK) &&
+	            (SQRLAXIRead(m_axi, &nonceLo, 0x5000+(28+i)*4) == SQRLAXIResultOK))
+	          nonces.push_back((((uint64_t)nonceHi) << 32ULL) | (uint64_t)nonceLo);
+	      }
+	    }
+	    // Clear the slots, keeping interrupt delivery enabled
+	    SQRLAXIWrite(m_axi, 0x00010001, 0x506c, false);
+	  }
+	  // A result may be both queued as an interrupt and still flagged in its slot
+	  std::sort(nonces.begin(), nonces.end());
+	  nonces.erase(std::unique(nonces.begin(), nonces.end()), nonces.end());
+
+	  if (!nonces.empty()) {
+	    m_nonceWakes++;
+	    m_nonceWakeTotal += nonces.size();
+	    if (nonces.size() > m_nonceWakeMax) m_nonceWakeMax = nonces.size();
+	  }
 	}
 
+	// Slots picked up by the legacy polling path
+	for (int i=0; i < 4; i++) {
+          if (nonceValid[i])
+            nonces.push_back(nonce[i]);
+	}
+	for (auto const& n : nonces) {
+          if (std::find(m_submitted.begin(), m_submitted.end(), n) != m_submitted.end())
+            continue;
+          m_submitted.push_back(n);
+          if (m_submitted.size() > submittedNonceHistory)
+            m_submitted.pop_front();
+          auto sol = Solution{n, h256(0), w, std::chrono::steady_clock::now(), m_index, falseTarget};
+ 
+          sqrllog << EthWhite << "Job: " << w.header.abridged()
+               << " Sol: " << toHex(sol.nonce, HexPrefix::Add) << EthReset;
+          Farm::f().submitProof(sol);
+	}
+
+	// Counters, stall detection and tuning only run when a status poll is due
+	if (std::chrono::steady_clock::now() < nextStatus)
+	  continue;
+	nextStatus = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_settings.statusInterval);
+
         // Get stall check parameters
 	uint32_t sCnt;
 	uint32_t tChkLo, tChkHi;
@@ -900,17 +1672,22 @@ void SQRLMiner::search(const dev::eth::WorkPackage& w)
 	    sCnt = 0;
 	  } 
 	}
+	bool countersRead = true;
 	err = SQRLAXIRead(m_axi, &tChkLo, 0x5048);
 	if (err != 0) {
           sqrllog << "Error reading target check counter";
 	  tChkLo = 0;
+	  countersRead = false;
 	} 
 	err = SQRLAXIRead(m_axi, &tChkHi, 0x5044);
         if (err != 0) {
           sqrllog << "Error reading target check counter";
 	  tChkHi = 0;
+	  countersRead = false;
 	} 
 	uint64_t tChks = ((uint64_t)tChkHi << 32) + tChkLo;
+	if (countersRead)
+	  heartbeat();
 
 	uint64_t newTChks = 0;
 	if (!((tChkLo == 0) && (tChkHi == 0))) {
@@ -921,6 +1698,7 @@ void SQRLMiner::search(const dev::eth::WorkPackage& w)
 	  newTChks = tChks - lastTChecks;
 	}
 	lastTChecks = tChks; 
+	recordCoverage(w, searchStart, tChks);
 
 	uint8_t shouldReset = 0;
 	if (!m_settings.skipStallDetection && (sCnt == lastSCnt)) {
@@ -929,80 +1707,260 @@ void SQRLMiner::search(const dev::eth::WorkPackage& w)
 	}
 	lastSCnt = sCnt;
 
-	for (int i=0; i < 4; i++) {
-          if (nonceValid[i]) {
-            auto sol = Solution{nonce[i], h256(0), w, std::chrono::steady_clock::now(), m_index};
- 
-            sqrllog << EthWhite << "Job: " << w.header.abridged()
-                 << " Sol: " << toHex(sol.nonce, HexPrefix::Add) << EthReset;
-            Farm::f().submitProof(sol);
-	  }
-	}
-   
         // Update the hash rate
         updateHashRate(1, newTChks);
 
         //Auto tune and temperature check
         m_tuner->tune(newTChks);
+        // Intensity the tuner moved to is programmed at the next search start
+        auto tuned = m_tuner->getIntensitySettings();
+        bool tunerRestart = tuned.isSet() && (tuned.patience != m_settings.patience ||
+            tuned.intensityN != m_settings.intensityN || tuned.intensityD != m_settings.intensityD);
        
-        //For hashrate averages
-        processHashrateAverages(newTChks);
+        //Hashrate averages are fed by updateHashRate, the error rate estimate by the tuner
+        processErrorRate();
+
+
+        // Statistical stall / degradation detection
+        auto pollTime = std::chrono::steady_clock::now();
+        double pollSeconds = std::chrono::duration_cast<std::chrono::milliseconds>(pollTime - lastPoll).count() / 1000.0;
+        lastPoll = pollTime;
+        if (m_settings.healthMonitor) {
+          HealthEvent event = m_health->update(newTChks, pollSeconds, countersRead, m_lastClk);
+          if (event != HealthEvent::None && handleHealthEvent(event))
+            shouldReset = 1;
+        }
 
+        // Thermal and power governor, hands clock and intensity to the tuner while it runs
+        bool thermalRestart = false;
+        if (m_governor->enabled()) {
+          if (m_tuner->isTuning())
+            m_governor->reset();
+          else
+            thermalRestart = handleThermalAction(
+                m_governor->update(m_FPGAtemps, boardPower(), pollSeconds, m_lastClk));
+        }
 
-	if (shouldReset) break; // Let core reset
+	if (shouldReset) {
+	  m_pendingStallResets++;
+	  break; // Let core reset
+	}
+	if (thermalRestart || tunerRestart) break; // Program the new intensity
+
+        if (std::chrono::steady_clock::now() - m_lastHistorySave >= std::chrono::minutes(10))
+          saveHistory();
+
+        // Periodic DAG integrity check
+        if (m_settings.dagVerifySamples && m_settings.dagVerifyInterval &&
+            (std::chrono::steady_clock::now() - m_lastDagVerify >=
+                std::chrono::minutes(m_settings.dagVerifyInterval)))
+        {
+            if (!checkDAG() && m_dagInvalid)
+                break;  // Regenerate before continuing
+        }
     }
     // Ensure core is in reset
     StopHashcore(true);
     axiMutex.unlock();
 
 }
-void SQRLMiner::processHashrateAverages(uint64_t newTcks)
+/*
+ * Carries out a thermal governor decision. Called from the search loop with
+ * axiMutex held
+ */
+bool SQRLMiner::handleThermalAction(ThermalAction action)
 {
-    m_hashCounter += newTcks;
-
-
-    auto elapsedSeconds = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::steady_clock::now() - (std::chrono::steady_clock::time_point)m_avgHashTimer)
-                              .count();
+    switch (action)
+    {
+    case ThermalAction::Intensity:
+        return true;
+    case ThermalAction::ClockDown:
+    {
+        double fromClock = m_lastClk;
+        double nextClock = m_tuner->getLowerClockStep(fromClock);
+        if (nextClock <= 0) {
+            sqrllog << EthRed << "Thermal: minimum frequency reached";
+            break;
+        }
+        setClock(nextClock, true);
+        m_governor->clockChanged(action, fromClock);
+        sqrllog << EthOrange << "Thermal: clock " << m_lastClk << "MHz" << EthReset;
+        break;
+    }
+    case ThermalAction::ClockUp:
+    {
+        double fromClock = m_lastClk;
+        double baseClock = m_governor->getBaseClock();
+        double nextClock = baseClock;
+        for (double step : getClockSteps())
+            if (step > fromClock + 1) {
+                nextClock = std::min(step, baseClock);
+                break;
+            }
+        if (nextClock > fromClock) {
+            setClock(nextClock, true);
+            sqrllog << EthOrange << "Thermal: clock " << m_lastClk << "MHz" << EthReset;
+        }
+        m_governor->clockChanged(action, fromClock);
+        break;
+    }
+    default:
+        break;
+    }
+    return false;
+}
 
-    if (elapsedSeconds > 60)
+/*
+ * Takes the configured action for a health event. Called from the search loop
+ * with axiMutex held
+ */
+bool SQRLMiner::handleHealthEvent(HealthEvent event)
+{
+    HealthAction action = m_health->actionFor(event);
+    sqrllog << EthRed << "Health: " << HealthMonitor::eventName(event) << " detected" << EthReset;
+    bool restart = false;
+    switch (action)
     {
-        double avg1min = (m_hashCounter / 60) / pow(10, 6);
-        float errorRate = m_tuner->getHardwareErrorRate() * 100;
+    case HealthAction::ResetCore:
+        sqrllog << EthRed << "Health: resetting core";
+        restart = true;
+        break;
+    case HealthAction::Downclock:
+        if (m_tuner->getTuningStage() > 0) {
+            sqrllog << EthRed << "Health: tuning in progress, not downclocking";
+        } else {
+            double nextClock = m_tuner->getLowerClockStep(m_lastClk);
+            if (nextClock > 0) {
+                sqrllog << EthRed << "Health: downclocking to " << nextClock << "MHz";
+                setClock(nextClock, true);
+            } else {
+                sqrllog << EthRed << "Health: minimum frequency reached";
+            }
+        }
+        break;
+    case HealthAction::ReDAG:
+        sqrllog << EthRed << "Health: invalidating DAG for regeneration";
+        SQRLAXIWrite(m_axi, 0x0, 0x40B8, true);
+        m_dagInvalid = true;
+        restart = true;
+        break;
+    default:
+        break;
+    }
+    m_health->acknowledge();
+    return restart;
+}
 
-        if (avg1min > 10 && avg1min < 100)  // check for flukes
+/*
+ * Nonce coverage - the core hashes upwards from nonceStart and its target check
+ * counter restarts with it, so start + checks (less what may still be in flight)
+ * has been covered. A job searched again resumes past what it already covered
+ */
+uint64_t SQRLMiner::resumeNonce(const WorkPackage& w)
+{
+    auto it = m_coverage.find(w.header);
+    if (it == m_coverage.end())
+    {
+        // Superseded jobs are rarely searched again, forget them
+        if (m_coverage.size() >= 8)
+            m_coverage.clear();
+        return w.startNonce;
+    }
+    for (auto const& r : it->second)
+    {
+        if (r.first <= w.startNonce && w.startNonce < r.second)
         {
-            m_10minHashAvg.push_back(avg1min);
-            m_60minHashAvg.push_back(avg1min);
+            sqrllog << "Resuming job " << w.header.abridged() << " past " << (r.second - r.first)
+                    << " covered nonces";
+            return r.second;
         }
-        if (m_10minHashAvg.size() > 10)
-            m_10minHashAvg.erase(m_10minHashAvg.begin());  // pop front
+    }
+    return w.startNonce;
+}
 
-        if (m_60minHashAvg.size() > 60)
-            m_60minHashAvg.erase(m_60minHashAvg.begin());  // pop front
+void SQRLMiner::recordCoverage(const WorkPackage& w, uint64_t start, uint64_t checked)
+{
+    if (checked <= SQRL_NONCES_IN_FLIGHT)
+        return;
+    uint64_t end = start + checked - SQRL_NONCES_IN_FLIGHT;
+    auto& ranges = m_coverage[w.header];
+    for (auto& r : ranges)
+    {
+        // Extends the range this run resumed from
+        if (r.first <= start && start <= r.second)
+        {
+            r.second = std::max(r.second, end);
+            return;
+        }
+    }
+    ranges.emplace_back(start, end);
+}
 
-        double avg10min = average(m_10minHashAvg);
-        double avg60min = average(m_60minHashAvg);
+void SQRLMiner::processErrorRate()
+{
+    auto elapsedSeconds = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - (std::chrono::steady_clock::time_point)m_avgHashTimer)
+                              .count();
 
-        m_avgValues[0] = avg1min;
-        m_avgValues[1] = avg10min;
-        m_avgValues[2] = avg60min;
-        m_avgValues[3] = errorRate;
+    if (elapsedSeconds > 60)
+    {
+        // Over the latest shares, not just the current tuning period
+        auto& errors = m_tuner->getErrorEstimator();
+        m_errorRate = errors.windowRate() * 100;
+        m_errorRateLower = errors.windowLower() * 100;
+        m_errorRateUpper = errors.windowUpper() * 100;
+
+        // Alert once the rate is above what the tuner accepts with 95% confidence
+        bool alert = m_errorRateLower > 3;
+        if (alert && !m_errorRateAlert)
+          sqrllog << EthRed << "sqrl-" << m_index << " Hardware error rate "
+                  << format2decimal(m_errorRate) << "% [" << format2decimal(m_errorRateLower)
+                  << "-" << format2decimal(m_errorRateUpper) << "%] over "
+                  << errors.windowSamples() << " shares" << EthReset;
+        m_errorRateAlert = alert;
 
         m_avgHashTimer = std::chrono::steady_clock::now();
-        m_hashCounter = 0;
     }
 }
-double SQRLMiner::average(std::vector<double> const& v)
-{
-    return std::accumulate(v.begin(), v.end(), 0.0) / v.size();
-}
 
 double SQRLMiner::getClock() {
   return setClock(-1);
 }
 
-double SQRLMiner::setClock(double targetClk) {
+/*
+ * Every clock the CLKOUT0 divider (1/8 steps from 2) reaches at this VCO.
+ * Neighbours closer than 1% are merged, the tuner gains nothing stepping those
+ */
+void SQRLMiner::buildClockSteps(double vco)
+{
+  vector<double> steps;
+  for (double div = 2.0; vco / div >= 50; div += 0.125) {
+    double f = vco / div;
+    if (steps.empty() || steps.back() - f >= steps.back() * 0.01)
+      steps.push_back(f);
+  }
+  std::reverse(steps.begin(), steps.end());
+
+  std::lock_guard<std::mutex> l(m_clockStepsMutex);
+  m_clockSteps = steps;
+  m_clockStepsVCO = vco;
+  if (!steps.empty())
+    sqrllog << "VCO " << format2decimal(vco) << "MHz - " << steps.size() << " clock steps from "
+            << format2decimal(steps.front()) << " to " << format2decimal(steps.back()) << "MHz";
+}
+
+vector<double> SQRLMiner::getClockSteps()
+{
+  std::lock_guard<std::mutex> l(m_clockStepsMutex);
+  return m_clockSteps;
+}
+
+/*
+ * -1 reads the clock, 0 leaves it alone, below -1 resets it to stock. A target rounds down to the
+ * next reachable step (+1MHz slack for clocks shown truncated), exact picks the
+ * step nearest to it - for values taken from getClockSteps()
+ */
+double SQRLMiner::setClock(double targetClk, bool exact) {
   uint32_t valueVCO;
   SQRLAXIResult err = SQRLAXIRead(m_axi, &valueVCO, 0x8200);
   if (err != 0) {
@@ -1020,6 +1978,8 @@ double SQRLMiner::setClock(double targetClk) {
   double gdiv = (valueVCO & 0xF);
   double vco = 200.0 * (mult+frac);
   vco /= gdiv;
+  if (vco != m_clockStepsVCO)
+    buildClockSteps(vco);
 
   uint32_t valueClk0;
   err = SQRLAXIRead(m_axi, &valueClk0, 0x8208);
@@ -1028,52 +1988,57 @@ double SQRLMiner::setClock(double targetClk) {
     return 0.0;
   }
 
-  double clk0div = (double)(valueClk0 & 0xF);
+  double clk0div = (double)(valueClk0 & 0xFF);  // 8 bit integer part, the ladder goes past 15
   double clk0FracDiv = ((double)((valueClk0 >> 8) & 0x3FF))/1000;
   clk0div += clk0FracDiv;
 
   double currentClk = vco / clk0div;
 
-  // Changing?
-  uint32_t nItems,rnItems;
-  uint32_t daggenPwrState;
-  if (targetClk != -1.0) {
-    // Make sure we backup mining parameters - clock unlock can reset these
-    err = SQRLAXIRead(m_axi, &nItems, 0x5040);
-    if (err != 0) {
-      sqrllog << "Fatal error preserving settings for clock change";
-      nItems = 0;
-    } 
-    SQRLAXIRead(m_axi, &rnItems, 0x5088);
-    if (err != 0) {
-      sqrllog << "Fatal error preserving settings for clock change";
-      rnItems = 0;
-    } 
-    // Ensure DAGGEN is powered on
-    SQRLAXIRead(m_axi, &daggenPwrState, 0xB000);   
-    if (err != 0) {
-      sqrllog << "Fatal error preserving settings for clock change";
-      daggenPwrState = 0;
-    } 
-    SQRLAXIWrite(m_axi, 0xFFFFFFFF, 0xB000, true);   
-  }
+  // -1 reads, 0 (no clock configured) leaves the clock as it is
+  if (targetClk == -1.0 || targetClk == 0)
+    return currentClk;
+
+  // Work out the new divider first - nothing to save or restore if it doesn't move
+  uint32_t newDiv = 0;
+  double desiredDiv = 0;
   if (targetClk > 0) {
-    double desiredDiv = vco/(targetClk+1); // Handles rounding when user tries to set a "UI" clock
-    // Adjust to be multiple of 0.125 (round up == closed without going over
-    desiredDiv = ((double)((int)(desiredDiv * 8 + 0.99))) / 8.0;
+    if (exact) {
+      desiredDiv = round(vco / targetClk * 8) / 8.0;
+    } else {
+      desiredDiv = vco/(targetClk+1); // Handles rounding when user tries to set a "UI" clock
+      // Adjust to be multiple of 0.125 (round up == closed without going over
+      desiredDiv = ((double)((int)(desiredDiv * 8 + 0.99))) / 8.0;
+    }
     if (desiredDiv < 2.0) {
       // Over max clock
       sqrllog << "CoreClk would exceed limit"; 
-    } else {
-      uint32_t newDiv = ((uint8_t)desiredDiv) | ((uint16_t)((desiredDiv-floor(desiredDiv))*1000.0) << 8);
-      SQRLAXIWrite(m_axi, valueVCO, 0x8200, true);
-      SQRLAXIWrite(m_axi, newDiv, 0x8208, true);
-      SQRLAXIWrite(m_axi, 0x7, 0x825c, true);
-      SQRLAXIWrite(m_axi, 0x3, 0x825c, true);
-      currentClk = vco/desiredDiv;
-      sqrllog << "Setting CoreClk to " << (int)currentClk;
+      return currentClk;
+    }
+    newDiv = ((uint8_t)desiredDiv) | ((uint16_t)((desiredDiv-floor(desiredDiv))*1000.0) << 8);
+    if (newDiv == (valueClk0 & 0x3FFFF)) {
       m_lastClk = (int)currentClk;
+      return currentClk;
     }
+  }
+
+  // Make sure we backup mining parameters - clock unlock can reset these. DAGGEN
+  // stays in whatever power state it is in, off while mining or tuning
+  auto changeStart = std::chrono::steady_clock::now();
+  uint32_t nItems = 0, rnItems = 0;
+  if (SQRLAXIRead(m_axi, &nItems, 0x5040) != SQRLAXIResultOK ||
+      SQRLAXIRead(m_axi, &rnItems, 0x5088) != SQRLAXIResultOK) {
+    sqrllog << "Fatal error preserving settings for clock change";
+    return currentClk;
+  }
+
+  // Posted writes - the last one is acknowledged, so the load is in before lock is polled
+  if (targetClk > 0) {
+    SQRLAXIWrite(m_axi, valueVCO, 0x8200, false);
+    SQRLAXIWrite(m_axi, newDiv, 0x8208, false);
+    SQRLAXIWrite(m_axi, 0x7, 0x825c, false);
+    SQRLAXIWrite(m_axi, 0x3, 0x825c, true);
+    currentClk = vco/desiredDiv;
+    m_lastClk = (int)currentClk;
   } else if (targetClk < -1.0) {
     sqrllog << "Resetting CoreClk to Stock";
     // Reset to factory defaults
@@ -1086,46 +2051,65 @@ double SQRLMiner::setClock(double targetClk) {
 #endif
     SQRLAXIWrite(m_axi, 0xA, 0x8000, true);
   }
-  if (targetClk != -1.0) {
-    // Wait for locked
-    uint32_t waitCnt=1000;
-    while(waitCnt--) {
-      uint32_t locked;
-      SQRLAXIRead(m_axi, &locked, 0x8004);
-      if (locked&1) break;
-    }
-    if (waitCnt == 0) {
-      sqrllog << "Timed out waiting for clock change to re-lock";
-    } 
 
-    // Make sure we restore the mining parameters 
-    SQRLAXIWrite(m_axi, nItems, 0x5040, true);
-    SQRLAXIWrite(m_axi, rnItems, 0x5088, true);
-    SQRLAXIWrite(m_axi, daggenPwrState, 0xB000, true);
+  // Wait for locked, backing off from 100us up to 5ms between polls, 200ms in all
+  bool locked = false;
+  unsigned backoffUs = 100;
+  while (true) {
+    uint32_t status = 0;
+    if (SQRLAXIRead(m_axi, &status, 0x8004) == SQRLAXIResultOK && (status & 1)) {
+      locked = true;
+      break;
+    }
+    if (std::chrono::steady_clock::now() - changeStart > std::chrono::milliseconds(200))
+      break;
+#ifdef _WIN32
+    Sleep((backoffUs + 999) / 1000);
+#else
+    usleep(backoffUs);
+#endif
+    backoffUs = std::min(backoffUs * 2, 5000u);
   }
+  if (!locked) {
+    sqrllog << "Timed out waiting for clock change to re-lock";
+  } 
+
+  // Make sure we restore the mining parameters 
+  SQRLAXIWrite(m_axi, nItems, 0x5040, false);
+  SQRLAXIWrite(m_axi, rnItems, 0x5088, true);
+
+  double downtimeMs = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - changeStart).count() / 1000.0;
+  m_clockChanges++;
+  m_clockDowntimeMs = m_clockDowntimeMs + downtimeMs;
+  if (targetClk > 0)
+    sqrllog << "Setting CoreClk to " << (int)currentClk << " (" << format2decimal(downtimeMs)
+            << "ms)";
   return currentClk;
 }
 
-void SQRLMiner::getTelemetry(unsigned int *tempC, unsigned int *fanprct, unsigned int *powerW) {
+void SQRLMiner::getTelemetry(HwSensorsType& _sensors) {
   // Temp Conversion: 
   // ((double)raw * 507.6 / 65536.0) - 279.43;
   // Volt Conversion
   // ((double)raw * 3.0 / 65536.0);
 
+  _sensors = HwSensorsType();
+  if (m_axi == NULL)  // Connect failed, nothing to read until the supervisor restarts us
+    return;
+
   // Read general SYSMON temp 
   axiMutex.lock();
   uint32_t raw;
   if (SQRLAXIResultOK == SQRLAXIRead(m_axi, &raw, 0x3400)) {
-    (*tempC) = ((double)raw * 507.6 / 65536.0) - 279.43;
-  } else {
-    (*tempC) = 0;
+    _sensors.tempC = ((double)raw * 507.6 / 65536.0) - 279.43;
   }
-  (*fanprct) = getClock(); 
+  _sensors.clockMHz = getClock(); 
   if (SQRLAXIResultOK == SQRLAXIRead(m_axi, &raw, 0x3404)) {
-    (*powerW) = ((double)raw * 3.0 / 65536.0) * 1000.0;
-  } else {
-    (*powerW) = 0;
+    _sensors.voltage = ((double)raw * 3.0 / 65536.0);
   }
+  // Cached by the search loop, the IIC sequence is too slow for the io thread
+  _sensors.powerW = (m_inputPower > 0) ? (double)m_inputPower : (double)m_railPower;
 
   // Read the HBM stack control values
   // Force "calibrated" if comms fail (Avoid cascaded errors)
@@ -1150,23 +2134,65 @@ void SQRLMiner::getTelemetry(unsigned int *tempC, unsigned int *fanprct, unsigne
     	    << (int)rightTemp << "C";
   }
   
-  float voltage = (*powerW) / 1000.0; 
-  int temp = (*tempC);
+  float voltage = _sensors.voltage;
+  int temp = _sensors.tempC;
 
   m_FPGAtemps[0] = temp;
   m_FPGAtemps[1] = leftTemp;
   m_FPGAtemps[2] = rightTemp;
 
+  SQRLDagPhase dagPhase = m_dagPhase;
+  if (dagPhase == SQRLDagPhase::LightCache)
+      s << EthPurple << " LightCache...";
+  else if (dagPhase == SQRLDagPhase::DAG)
+      s << EthPurple << " DAG " << format2decimal((double)m_dagProgress) << "%";
+  else if (dagPhase == SQRLDagPhase::Duplicate)
+      s << EthPurple << " DAG Duplication " << format2decimal((double)m_dagProgress) << "%";
+
   uint8_t tunerStage = m_tuner->getTuningStage(); 
   if (tunerStage > 0)  // still tuning
       s << EthRed << " Tuning... S" << (int)tunerStage;
   
+  uint64_t axiOps = SQRLAXIGetTransactionCount(m_axi);
+  auto axiOpsTime = std::chrono::steady_clock::now();
+  auto axiOpsMs = std::chrono::duration_cast<std::chrono::milliseconds>(axiOpsTime - m_lastAxiOpsTime).count();
+  if (axiOpsMs > 0)
+    m_axiOpsRate = (float)(axiOps - m_lastAxiOps) * 1000.0f / axiOpsMs;
+  m_lastAxiOps = axiOps;
+  m_lastAxiOpsTime = axiOpsTime;
+  s << EthWhite << " AXI " << (int)m_axiOpsRate << "/s";
+
+  if (_sensors.powerW > 0) {
+    double mhs = hashRateStats().mean(HashRateStats::Min1) / pow(10, 6);
+    s << EthWhite << " " << format2decimal(_sensors.powerW) << "W";
+    if (m_inputPower > 0 && m_railPower > 0)
+      s << " (VCCINT " << format2decimal((double)m_railPower) << "W)";
+    s << " " << format2decimal((mhs / _sensors.powerW)) << "MH/J";
+  }
+
+  if (m_clockChanges)
+    s << EthWhite << " Clk changes " << m_clockChanges << " avg "
+      << format2decimal((m_clockDowntimeMs / m_clockChanges)) << "ms";
+
+  if (m_settings.healthMonitor)
+    s << EthWhite << " Health " << m_health->status();
+
+  if (m_governor->getDerate() > 0 || m_governor->getBaseClock() > 0 || m_governor->getPowerLimit() > 0)
+    s << EthOrange << " Thermal " << m_governor->status();
+
+  if (m_nonceWakes)
+    s << EthWhite << " Nonces/wake" << format2decimal(((double)m_nonceWakeTotal / m_nonceWakes))
+      << " max " << m_nonceWakeMax;
+
   //Average hashrate block
   sqrllog << EthTeal << "sqrl-" << m_index << EthLime
-          << " Avg 1m:" << format2decimal(m_avgValues[0])
-          << " 10m:" << format2decimal(m_avgValues[1]) << " 60m:" << format2decimal(m_avgValues[2])
-          << "Mhs" << EthPurple << " Err=" << format2decimal(m_avgValues[3])
-          << "% [P=" << m_settings.patience << " N=" << m_settings.intensityN
+          << " Avg 1m:" << format2decimal((hashRateStats().mean(HashRateStats::Min1) / pow(10, 6)))
+          << " 10m:" << format2decimal((hashRateStats().mean(HashRateStats::Min10) / pow(10, 6)))
+          << " 1h:" << format2decimal((hashRateStats().mean(HashRateStats::Hour1) / pow(10, 6)))
+          << " 24h:" << format2decimal((hashRateStats().mean(HashRateStats::Hour24) / pow(10, 6)))
+          << "Mhs" << EthPurple << " Err=" << format2decimal(m_errorRate) << "% ("
+          << format2decimal(m_errorRateLower) << "-" << format2decimal(m_errorRateUpper)
+          << ") [P=" << m_settings.patience << " N=" << m_settings.intensityN
           << " D=" << m_settings.intensityD << "] " << EthWhite << m_lastClk << "MHz "
           << format2decimal(voltage) << "V " << temp << "C " << s.str();
   
@@ -1202,6 +2228,8 @@ void SQRLMiner::workLoop()
 
     while (!shouldStop())
     {
+        heartbeat();
+
         // Wait for work or 3 seconds (whichever the first)
         const WorkPackage w = work();
         if (!w)
@@ -1228,6 +2256,15 @@ void SQRLMiner::workLoop()
                 continue;
             }
 
+            // DAG failed verification, regenerate it outside the DAG load schedule
+            if (m_dagInvalid)
+            {
+                if (!initEpoch_internal())
+                    break;
+                current = w;
+                continue;
+            }
+
             // Persist most recent job.
             // Job's differences should be handled at higher level
             current = w;
@@ -1245,65 +2282,293 @@ void SQRLMiner::workLoop()
 }
 
 
-void SQRLMiner::enumDevices(std::map<string, DeviceDescriptor>& _DevicesCollection, SQSettings _settings)
+static bool parseIPv4(const string& _s, uint32_t& _ip)
+{
+    unsigned a, b, c, d;
+    char tail;
+    if (sscanf(_s.c_str(), "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 || a > 255 || b > 255 ||
+        c > 255 || d > 255)
+        return false;
+    _ip = (a << 24) | (b << 16) | (c << 8) | d;
+    return true;
+}
+
+static string formatIPv4(uint32_t _ip)
+{
+    return to_string(_ip >> 24) + "." + to_string((_ip >> 16) & 0xff) + "." +
+           to_string((_ip >> 8) & 0xff) + "." + to_string(_ip & 0xff);
+}
+
+/*
+ * Expands the --sqrl-hosts entries into single ip:port endpoints. Each entry is
+ *   ip[:port]                 single board (port 2000 if omitted)
+ *   ip:first-last             port range on one host
+ *   a.b.c.first-last[:port]   last octet range
+ *   a.b.c.d/prefix[:port]     CIDR block, /16 or smaller
+ * and host and port ranges can be combined. Duplicates are dropped
+ */
+vector<string> SQRLMiner::expandHosts(const vector<string>& _specs)
 {
-    unsigned numDevices = getNumDevices(_settings);
-    if (numDevices == 1)  // 127.0.0.1:2000-20XX
+    vector<string> out;
+    std::set<string> seen;
+    for (auto spec : _specs)
     {
-        string s = _settings.hosts[0];
-        if ((s.find("-") != std::string::npos) && (s.find(":") != std::string::npos) && (s.find(":") < s.find("-")))
+        boost::trim(spec);
+        if (spec.empty())
+            continue;
+
+        string hostPart = spec, portPart = "2000";
+        size_t colon = spec.find(':');
+        if (colon != string::npos)
         {
-            vector<string> strs;
-            boost::split(strs, s, boost::is_any_of(":"));
+            hostPart = spec.substr(0, colon);
+            portPart = spec.substr(colon + 1);
+        }
 
-            string ip = strs[0];
-            string portRange = strs[1];
+        unsigned firstPort, lastPort;
+        try
+        {
+            size_t dash = portPart.find('-');
+            firstPort = stoul(portPart.substr(0, dash));
+            lastPort = (dash == string::npos) ? firstPort : stoul(portPart.substr(dash + 1));
+        }
+        catch (...)
+        {
+            sqrllog << EthRed << "Bad port in SQRL host " << spec << EthReset;
+            continue;
+        }
+        if (firstPort == 0 || lastPort > 65535 || lastPort < firstPort)
+        {
+            sqrllog << EthRed << "Bad port range in SQRL host " << spec << EthReset;
+            continue;
+        }
 
-            vector<string> ports;
-            boost::split(ports, portRange, boost::is_any_of("-"));
+        vector<string> hosts;
+        uint32_t ip;
+        size_t slash = hostPart.find('/');
+        size_t dash = hostPart.find('-');
+        if (slash != string::npos)
+        {
+            unsigned prefix = 0;
+            try
+            {
+                prefix = stoul(hostPart.substr(slash + 1));
+            }
+            catch (...)
+            {}
+            if (!parseIPv4(hostPart.substr(0, slash), ip) || prefix < 16 || prefix > 32)
+            {
+                sqrllog << EthRed << "Bad CIDR block in SQRL host " << spec << " (/16 to /32)"
+                        << EthReset;
+                continue;
+            }
+            uint32_t mask = (prefix == 32) ? 0xffffffff : ~(0xffffffffu >> prefix);
+            uint32_t first = ip & mask, last = first | ~mask;
+            if (prefix < 31)  // Skip the network and broadcast addresses
+            {
+                first++;
+                last--;
+            }
+            for (uint64_t a = first; a <= last; a++)
+                hosts.push_back(formatIPv4((uint32_t)a));
+        }
+        else if (dash != string::npos)
+        {
+            unsigned lastOctet = 0;
+            try
+            {
+                lastOctet = stoul(hostPart.substr(dash + 1));
+            }
+            catch (...)
+            {}
+            if (!parseIPv4(hostPart.substr(0, dash), ip) || lastOctet > 255 ||
+                lastOctet < (ip & 0xff))
+            {
+                sqrllog << EthRed << "Bad address range in SQRL host " << spec << EthReset;
+                continue;
+            }
+            for (unsigned o = ip & 0xff; o <= lastOctet; o++)
+                hosts.push_back(formatIPv4((ip & 0xffffff00) | o));
+        }
+        else
+        {
+            hosts.push_back(hostPart);
+        }
 
-            int startPort = std::stoi(ports[0]);
-            int endPort = std::stoi(ports[1]);
-            _settings.hosts.clear();
+        for (auto& h : hosts)
+            for (unsigned p = firstPort; p <= lastPort; p++)
+            {
+                string ep = h + ":" + to_string(p);
+                if (seen.insert(ep).second)
+                    out.push_back(ep);
+            }
+    }
+    return out;
+}
+
+/*
+ * Connects to the endpoints, each giving up after _timeoutMs, and reads the self
+ * test, DNA and bitstream. At most probeConcurrency run at once in the process,
+ * so a large range takes about one timeout per that many unreachable endpoints
+ */
+vector<SQRLProbeResult> SQRLMiner::probeHosts(const vector<string>& _hosts, unsigned _timeoutMs)
+{
+    vector<SQRLProbeResult> results(_hosts.size());
+    for (size_t i = 0; i < _hosts.size(); i++)
+    {
+        vector<string> words;
+        boost::split(words, _hosts[i], boost::is_any_of(":"), boost::token_compress_on);
+        results[i].host = words[0];
+        results[i].port = (words.size() > 1) ? stoul(words[1]) : 2000;
+    }
 
-            for (int i = startPort; i <= endPort; i++)
+    auto probe = [_timeoutMs](SQRLProbeResult& r) {
+        auto start = std::chrono::steady_clock::now();
+        SQRLAXIRef axi = SQRLAXICreateWithTimeout(
+            SQRLAXIConnectionTCP, (char*)r.host.c_str(), r.port, _timeoutMs);
+        if (axi != NULL)
+        {
+            r.reachable = true;
+            SQRLAXISetTimeout(axi, _timeoutMs);
+            r.selfTest = (SQRLAXITest(axi) == SQRLAXIResultOK);
+
+            // Same formatting as initDevice so it matches the tune/state keys
+            uint32_t dnaLo, dnaMid, dnaHi, bitstream;
+            if (SQRLAXIRead(axi, &dnaLo, 0x1000) == SQRLAXIResultOK &&
+                SQRLAXIRead(axi, &dnaMid, 0x1008) == SQRLAXIResultOK &&
+                SQRLAXIRead(axi, &dnaHi, 0x7000) == SQRLAXIResultOK)
+            {
+                std::stringstream s;
+                s << setfill('0') << setw(8) << std::hex << dnaLo << std::hex << dnaMid << std::hex
+                  << dnaHi;
+                r.dna = s.str();
+            }
+            if (SQRLAXIRead(axi, &bitstream, 0x8) == SQRLAXIResultOK)
             {
-                string newIpPort = ip + ":" + std::to_string(i);
-                _settings.hosts.push_back(newIpPort);
+                std::stringstream s;
+                s << setfill('0') << setw(8) << std::hex << bitstream;
+                r.bitstream = s.str();
             }
+            SQRLAXIDestroy(&axi);
+        }
+        r.ms = (unsigned)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start)
+                   .count();
+    };
+
+    // Slots shared with probes from other callers (devices added over the API)
+    static std::mutex slotsMutex;
+    static std::condition_variable slotFreed;
+    static unsigned inFlight = 0;
+
+    std::atomic<size_t> next = {0};
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next++) < results.size())
+        {
+            {
+                std::unique_lock<std::mutex> l(slotsMutex);
+                slotFreed.wait(l, [] { return inFlight < probeConcurrency; });
+                inFlight++;
+            }
+            probe(results[i]);
+            {
+                std::lock_guard<std::mutex> l(slotsMutex);
+                inFlight--;
+            }
+            slotFreed.notify_one();
+        }
+    };
+
+    vector<std::thread> workers;
+    size_t count = std::min(results.size(), (size_t)probeConcurrency);
+    workers.reserve(count);
+    for (size_t t = 0; t < count; t++)
+        workers.emplace_back(worker);
+    for (auto& t : workers)
+        t.join();
+    return results;
+}
 
-            numDevices = getNumDevices(_settings);
+void SQRLMiner::enumDevices(std::map<string, DeviceDescriptor>& _DevicesCollection, SQSettings _settings)
+{
+    vector<string> hosts = expandHosts(_settings.hosts);
+    vector<string> dnas(hosts.size());
+
+    if (_settings.probeTimeoutMs && !hosts.empty())
+    {
+        sqrllog << "Probing " << hosts.size() << " SQRL endpoint(s)";
+        auto start = std::chrono::steady_clock::now();
+        vector<SQRLProbeResult> results = probeHosts(hosts, _settings.probeTimeoutMs);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+
+        // Unreachable boards would block their miner thread forever in SQRLAXICreate, and a
+        // board reachable through two endpoints would be mined twice - keep neither
+        std::map<string, string> byDNA;
+        vector<string> usable;
+        unsigned unreachable = 0, duplicates = 0;
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            auto& r = results[i];
+            if (!r.reachable)
+            {
+                sqrllog << EthRed << hosts[i] << " unreachable" << EthReset;
+                unreachable++;
+                continue;
+            }
+            if (!r.dna.empty())
+            {
+                auto it = byDNA.find(r.dna);
+                if (it != byDNA.end())
+                {
+                    sqrllog << EthYellow << hosts[i] << " is the same FPGA (DNA " << r.dna
+                            << ") as " << it->second << " - skipped" << EthReset;
+                    duplicates++;
+                    continue;
+                }
+                byDNA[r.dna] = hosts[i];
+            }
+            sqrllog << hosts[i] << " DNA " << (r.dna.empty() ? "unreadable" : r.dna)
+                    << " Bitstream " << (r.bitstream.empty() ? "unreadable" : r.bitstream)
+                    << (r.selfTest ? "" : " (self test failed)") << " " << r.ms << " ms";
+            usable.push_back(hosts[i]);
+            dnas[usable.size() - 1] = r.dna;
         }
+        sqrllog << "Discovery: " << usable.size() << " reachable, " << unreachable
+                << " unreachable, " << duplicates << " duplicate in " << elapsed.count() << " ms";
+        hosts = usable;
     }
 
-    for (unsigned i = 0; i < numDevices; i++)
+    for (unsigned i = 0; i < hosts.size(); i++)
     {
-        string uniqueId;
-        ostringstream s;
+        string uniqueId = "sqrl-" + to_string(i);
         DeviceDescriptor deviceDescriptor;
-
-        s << "sqrl-" << i;
-        uniqueId = s.str();
         if (_DevicesCollection.find(uniqueId) != _DevicesCollection.end())
             deviceDescriptor = _DevicesCollection[uniqueId];
-        else
-            deviceDescriptor = DeviceDescriptor();
-
-        std::vector<std::string> words;
-        boost::split(words, _settings.hosts[i], boost::is_any_of(":"), boost::token_compress_on);
-
-	deviceDescriptor.sqHost = words[0];
-	deviceDescriptor.sqPort = (words.size() > 1)?stoi(words[1]):2000;
-
-        s.str("");
-        s.clear();
-        s << "SQRL TCP-FPGA (" << deviceDescriptor.sqHost << ":" << deviceDescriptor.sqPort << ")" ;
-        deviceDescriptor.name = s.str();
-        deviceDescriptor.uniqueId = uniqueId;
-        deviceDescriptor.type = DeviceTypeEnum::Fpga;
-        deviceDescriptor.totalMemory = getTotalPhysAvailableMemory();
-	deviceDescriptor.targetClk = _settings.targetClk;
-
+        describeDevice(deviceDescriptor, uniqueId, hosts[i], dnas[i], _settings);
         _DevicesCollection[uniqueId] = deviceDescriptor;
     }
 }
+
+/*
+ * Fills the descriptor of the board at _hostPort, at startup or when added at runtime
+ */
+void SQRLMiner::describeDevice(DeviceDescriptor& _device, const string& _uniqueId,
+    const string& _hostPort, const string& _dna, const SQSettings& _settings)
+{
+    std::vector<std::string> words;
+    boost::split(words, _hostPort, boost::is_any_of(":"), boost::token_compress_on);
+
+    _device.sqHost = words[0];
+    _device.sqPort = (words.size() > 1)?stoi(words[1]):2000;
+    _device.sqDNA = _dna;
+
+    ostringstream s;
+    s << "SQRL TCP-FPGA (" << _device.sqHost << ":" << _device.sqPort << ")" ;
+    _device.name = s.str();
+    _device.uniqueId = _uniqueId;
+    _device.type = DeviceTypeEnum::Fpga;
+    _device.totalMemory = getTotalPhysAvailableMemory();
+    _device.targetClk = _settings.targetClk;
+}
@@ -21,7 +21,9 @@ along with ethminer.  If not, see <http://www.gnu.org/licenses/>.
 #include <libethcore/EthashAux.h>
 #include <libethcore/Miner.h>
 #include "SQRLAXI.h"
+#include "SQRLStateStore.h"
 #include "AutoTuner.h"
+#include <deque>
 #include <functional>
 
 //#pragma optimize("", off)
@@ -39,56 +41,213 @@ struct SQRLChannel : public LogChannel
 };
 #define sqrllog clog(SQRLChannel)
 
+// Interrupt lines raised by the hashcore (see SQRLAXIWaitForInterrupt)
+#define SQRL_NONCE_INTERRUPT (1 << 0)
+#define SQRL_DAGGEN_INTERRUPT (1 << 1)  // LightCache/DAG generation complete
+
+// Nonces which may be issued but not yet target checked, not counted as covered
+#define SQRL_NONCES_IN_FLIGHT 4096
+
+// Capability block next to the device (0x0) and bitstream (0x8) IDs. This is a
+// proposed layout, no released bitstream implements it yet - all of them read
+// anything but the magic there and get the defaults of SQRLCapabilities
+#define SQRL_CAPS_MAGIC_ADDR 0x10
+#define SQRL_CAPS_FEATURES_ADDR 0x18
+#define SQRL_CAPS_LAYOUT_ADDR 0x20
+#define SQRL_CAPS_MAGIC 0x43415053  // 'CAPS'
+#define SQRL_CAP_CACHE_ON_CHIP (1 << 0)
+#define SQRL_CAP_NONCE_INTERRUPT (1 << 1)
+
+enum class SQRLDagPhase : uint8_t
+{
+    Idle,
+    LightCache,
+    DAG,
+    Duplicate
+};
+
+// DAGGEN/hashcore parameters derived from an epoch, computed ahead of the switch when pre-staged
+struct SQRLDagParams
+{
+    int epoch = -1;
+    uint32_t nItems = 0;          // 128 byte DAG items
+    uint32_t rnItems = 0;         // Reciprocal of nItems, adjusted to ETH optimized modulo
+    uint32_t numParentNodes = 0;  // 64 byte LightCache items
+    uint8_t revSeed[32] = {0};    // Seedhash in reverse byte order
+    uint32_t mixerSize = 0;
+    uint32_t mixerLeftover = 0;
+    vector<std::pair<uint32_t, uint32_t>> mixers;  // Start/end 64 byte item per DAG mixer
+};
+
+// What the loaded bitstream provides - defaults are what every bitstream without
+// the capability block is built with
+struct SQRLCapabilities
+{
+    bool reported = false;
+    bool cacheOnChip = true;      // LightCache generated on the module
+    bool nonceInterrupts = true;  // Nonces delivered as interrupts, else polled
+    unsigned nonceSlots = 4;      // Result slots at 0x5000+(19+i)*4 / 0x5000+(28+i)*4
+    unsigned dagMixers = 16;      // DAGGEN mixers, fixed at bitstream generation
+};
+
+// Outcome of the discovery probe of one endpoint
+struct SQRLProbeResult
+{
+    string host;
+    unsigned port = 2000;
+    bool reachable = false;
+    bool selfTest = false;  // UART self test answered
+    string dna;             // Empty if it could not be read
+    string bitstream;
+    unsigned ms = 0;        // Connect + probe time
+};
+
 class AutoTuner;
+class HealthMonitor;
+enum class HealthEvent : uint8_t;
+class ThermalGovernor;
+enum class ThermalAction : uint8_t;
 
 class SQRLMiner : public Miner
 {
 
 public:
-    SQRLMiner(unsigned _index, SQSettings _settings, DeviceDescriptor& _device, TelemetryType* telemetry);
+    SQRLMiner(unsigned _index, SQSettings _settings, DeviceDescriptor& _device);
     ~SQRLMiner() override;
 
     static unsigned getNumDevices(SQSettings _settings);
     static void enumDevices(std::map<string, DeviceDescriptor>& _DevicesCollection, SQSettings _settings);
+    static vector<string> expandHosts(const vector<string>& _specs);
+    static vector<SQRLProbeResult> probeHosts(const vector<string>& _hosts, unsigned _timeoutMs);
+    static void describeDevice(DeviceDescriptor& _device, const string& _uniqueId,
+        const string& _hostPort, const string& _dna, const SQSettings& _settings);
 
     void search(const dev::eth::WorkPackage& w);
-    void processHashrateAverages(uint64_t newTcks);
+    void processErrorRate();
 
-    void getTelemetry(unsigned int *tempC, unsigned int *fanprct, unsigned int *powerW) override;
+    void getTelemetry(HwSensorsType& _sensors) override;
+    float expectedHashRate() override;
+    float getThroughput();
+    h256 healthTarget();
+    float getBusOpsRate() override { return m_axiOpsRate; }
+    void setPowerLimit(float watts) override;
+    float powerDemand() override;
+    double boardPower();
 
     SQSettings* getSQsettigns() { return &m_settings; }
     unsigned getMinerIndex() { return m_index; }
 
     double getClock();
-    double setClock(double targetClk);
+    double setClock(double targetClk, bool exact = false);
+    vector<double> getClockSteps();
     string getSettingsID() { return m_settingID; }
     uint8_t* getFPGAtemps() { return m_FPGAtemps; }
     void setLastClock(double lastClk) { m_lastClk = lastClk; }
+    void saveDeviceState();
+    void saveTunedState(double clock, unsigned patience, unsigned intensityN, unsigned intensityD,
+        unsigned fkVout = 0, unsigned jcVout = 0);
+    void setVoltage(unsigned fkVCCINT = 0, unsigned jcVCCINT = 0);
+    void readVoltage(unsigned& fkVCCINT, unsigned& jcVCCINT);
+    bool powerMeasured() { return m_inputPower > 0 || m_railPower > 0; }
+
+    // Non-blocking epoch initialization progress (percent within the current phase)
+    SQRLDagPhase getDAGPhase() { return m_dagPhase; }
+    double getDAGProgress() { return m_dagProgress; }
 
 protected:
     bool initDevice() override;
 
-    void setVoltage(unsigned fkVCCINT = 0, unsigned jcVCCINT = 0);
-
     bool initEpoch_internal() override;
+    bool isDagReady(int epoch) override;
+    void prestageEpoch(EpochContext const& _ec) override;
     void kick_miner() override;
 
    
 
 private:
     string m_settingID = "";  // DNA_bitstream_V used for saving tuning config
+    string m_deviceKey = "";  // DNA_bitstream used for the persisted device state
 
     atomic<bool> m_new_work = {false};
     atomic<bool> m_dagging = {false};
+    atomic<SQRLDagPhase> m_dagPhase = {SQRLDagPhase::Idle};
+    atomic<double> m_dagProgress = {0};
    
     SQRLAXIRef m_axi = NULL;
     std::mutex axiMutex;
+    std::mutex iicMutex;  // Regulator IIC sequences - never held while taking axiMutex
     SQSettings m_settings;
     AutoTuner* m_tuner;
+    HealthMonitor* m_health;
+    ThermalGovernor* m_governor;
 
     void workLoop() override;
     SQRLAXIResult StopHashcore(bool soft);
+    bool waitForDaggenInterrupt(uint32_t timeoutMs);
+
+    // Bitstream capabilities
+    void readCapabilities();
+    SQRLCapabilities m_caps;
+
+    // Persisted device state
+    SQRLStateStore& stateStore() { return SQRLStateStore::open(m_settings.stateFile); }
+    bool loadDeviceState(SQRLDeviceState& state);
+    void saveHistory();
+    unsigned m_savedGood = 0;  // Share counters already in the store
+    unsigned m_savedFailed = 0;
+    unsigned m_pendingStallResets = 0;
+    unsigned m_pendingDagFailures = 0;
+    std::chrono::steady_clock::time_point m_lastHistorySave = std::chrono::steady_clock::now();
+
+    // Warm re-attach
+    bool tryWarmAttach();
+    bool m_warmAttach = false;
+    int m_warmEpoch = -1;
+
+    // Epoch pre-staging
+    SQRLDagParams computeDagParams(EpochContext const& _ec);
+    std::mutex m_prestageMutex;
+    SQRLDagParams m_prestaged;
+
+    // DAG integrity sampling
+    uint8_t verifyDAG(unsigned samples);
+    bool checkDAG();
+    atomic<bool> m_dagInvalid = {false};
+    unsigned m_dagVerifyFailures = 0;
+    std::chrono::steady_clock::time_point m_lastDagVerify = std::chrono::steady_clock::now();
   
+    // Board power over PMBus, read from the search loop and cached for telemetry
+    void readBoardPower();
+    atomic<double> m_inputPower = {0};
+    atomic<double> m_railPower = {0};
+    unsigned m_pmbusMisses = 0;
+    std::chrono::steady_clock::time_point m_lastPowerRead;
+
+    // AXI transaction rate, updated with telemetry
+    atomic<float> m_axiOpsRate = {0};
+    uint64_t m_lastAxiOps = 0;
+    std::chrono::steady_clock::time_point m_lastAxiOpsTime = std::chrono::steady_clock::now();
+
+    // Reacts to what the health monitor detected, true if the search must restart
+    bool handleHealthEvent(HealthEvent event);
+    // Carries out a thermal governor decision, true if the search must restart
+    bool handleThermalAction(ThermalAction action);
+
+    // Per-job nonce ranges already searched
+    std::map<h256, vector<std::pair<uint64_t, uint64_t>>> m_coverage;
+    uint64_t resumeNonce(const WorkPackage& w);
+    void recordCoverage(const WorkPackage& w, uint64_t start, uint64_t checked);
+
+    // Nonces collected per interrupt wake
+    atomic<uint64_t> m_nonceWakes = {0};
+    atomic<uint64_t> m_nonceWakeTotal = {0};
+    atomic<unsigned> m_nonceWakeMax = {0};
+
+    // Nonces already submitted for the current job - a result read from its slot
+    // can still raise its interrupt on a later wake
+    h256 m_submittedHeader;
+    std::deque<uint64_t> m_submitted;
+
     //Voltages
     double VoltageTbl[256] = { 0.0 };
 
@@ -98,15 +257,20 @@ private:
 
     //Clock
     atomic<double> m_lastClk = {0};
+    void buildClockSteps(double vco);
+    std::mutex m_clockStepsMutex;
+    vector<double> m_clockSteps;  // Reachable clocks, lowest first
+    atomic<double> m_clockStepsVCO = {0};
+    atomic<unsigned> m_clockChanges = {0};
+    atomic<double> m_clockDowntimeMs = {0};
 
-    //Averages
-    double m_hashCounter = 0;
-    double m_avgValues[4]; //1min avg hash, 10min avg hash, 60min avg hash, error rate
-    vector<double> m_10minHashAvg;
-    vector<double> m_60minHashAvg;
+    //Averages - hashrate windows are kept by the Miner's HashRateStats
+    double m_errorRate = 0;  // Percent, with the 95% interval bounds
+    double m_errorRateLower = 0;
+    double m_errorRateUpper = 0;
+    bool m_errorRateAlert = false;
     uint8_t m_FPGAtemps[3];//core,HBM-left,HBM-right;
    
-    double average(std::vector<double> const& v);
     atomic<std::chrono::steady_clock::time_point> m_avgHashTimer = {
         std::chrono::steady_clock::now()};
 
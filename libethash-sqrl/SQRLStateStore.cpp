@@ -0,0 +1,249 @@
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+
+#include "SQRLStateStore.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace dev;
+using namespace eth;
+
+/*
+ * Stores are never released - miners come and go, the file stays the same
+ */
+SQRLStateStore& SQRLStateStore::open(const string& path)
+{
+    static std::mutex storesMutex;
+    static std::map<string, unique_ptr<SQRLStateStore>> stores;
+
+    std::lock_guard<std::mutex> l(storesMutex);
+    auto& store = stores[path];
+    if (!store)
+        store.reset(new SQRLStateStore(path));
+    return *store;
+}
+
+template <typename T>
+static void readField(const map<string, string>& fields, const char* name, T& value)
+{
+    auto it = fields.find(name);
+    if (it == fields.end())
+        return;
+    istringstream is(it->second);
+    T parsed;
+    if (is >> parsed)
+        value = parsed;
+}
+
+/*
+ * DNA_bitstream,epoch,clock,patience,intensityN,intensityD,fkVCCINT,jcVCCINT
+ */
+static bool parseLegacyLine(const string& line, string& key, SQRLDeviceState& state)
+{
+    vector<string> words;
+    boost::split(words, line, boost::is_any_of(","), boost::token_compress_on);
+    if (words.size() < 8)
+        return false;
+    try
+    {
+        key = words[0];
+        state.epoch = stoi(words[1]);
+        state.clock = stod(words[2]);
+        state.patience = stoi(words[3]);
+        state.intensityN = stoi(words[4]);
+        state.intensityD = stoi(words[5]);
+        state.fkVCCINT = stoi(words[6]);
+        state.jcVCCINT = stoi(words[7]);
+    }
+    catch (const exception&)
+    {
+        return false;
+    }
+    return true;
+}
+
+static bool parseLine(const string& line, string& key, SQRLDeviceState& state)
+{
+    vector<string> words;
+    boost::split(words, line, boost::is_any_of(" \t"), boost::token_compress_on);
+    if (words.empty() || words[0].empty())
+        return false;
+    if (words.size() == 1)
+        return parseLegacyLine(words[0], key, state);
+
+    map<string, string> fields;
+    for (size_t i = 1; i < words.size(); i++)
+    {
+        auto eq = words[i].find('=');
+        if (eq != string::npos)
+            fields[words[i].substr(0, eq)] = words[i].substr(eq + 1);
+    }
+    key = words[0];
+
+    readField(fields, "epoch", state.epoch);
+    readField(fields, "clock", state.clock);
+    readField(fields, "patience", state.patience);
+    readField(fields, "intensityN", state.intensityN);
+    readField(fields, "intensityD", state.intensityD);
+    readField(fields, "fkVCCINT", state.fkVCCINT);
+    readField(fields, "jcVCCINT", state.jcVCCINT);
+
+    readField(fields, "tunedClock", state.tunedClock);
+    readField(fields, "tunedPatience", state.tunedPatience);
+    readField(fields, "tunedIntensityN", state.tunedIntensityN);
+    readField(fields, "tunedIntensityD", state.tunedIntensityD);
+    readField(fields, "tunedFkVCCINT", state.tunedFkVCCINT);
+    readField(fields, "tunedJcVCCINT", state.tunedJcVCCINT);
+    readField(fields, "tunedFkVout", state.tunedFkVout);
+    readField(fields, "tunedJcVout", state.tunedJcVout);
+
+    readField(fields, "goodClock", state.goodClock);
+    readField(fields, "goodFkVCCINT", state.goodFkVCCINT);
+    readField(fields, "goodJcVCCINT", state.goodJcVCCINT);
+
+    readField(fields, "goodShares", state.goodShares);
+    readField(fields, "failedShares", state.failedShares);
+    readField(fields, "sessions", state.sessions);
+    readField(fields, "initFailures", state.initFailures);
+    readField(fields, "stallResets", state.stallResets);
+    readField(fields, "dagFailures", state.dagFailures);
+    readField(fields, "lastSeen", state.lastSeen);
+    return true;
+}
+
+static string formatLine(const string& key, const SQRLDeviceState& s)
+{
+    ostringstream os;
+    os << key << " epoch=" << s.epoch << " clock=" << s.clock << " patience=" << s.patience
+       << " intensityN=" << s.intensityN << " intensityD=" << s.intensityD
+       << " fkVCCINT=" << s.fkVCCINT << " jcVCCINT=" << s.jcVCCINT
+       << " tunedClock=" << s.tunedClock << " tunedPatience=" << s.tunedPatience
+       << " tunedIntensityN=" << s.tunedIntensityN << " tunedIntensityD=" << s.tunedIntensityD
+       << " tunedFkVCCINT=" << s.tunedFkVCCINT << " tunedJcVCCINT=" << s.tunedJcVCCINT
+       << " tunedFkVout=" << s.tunedFkVout << " tunedJcVout=" << s.tunedJcVout
+       << " goodClock=" << s.goodClock << " goodFkVCCINT=" << s.goodFkVCCINT
+       << " goodJcVCCINT=" << s.goodJcVCCINT << " goodShares=" << s.goodShares
+       << " failedShares=" << s.failedShares << " sessions=" << s.sessions
+       << " initFailures=" << s.initFailures << " stallResets=" << s.stallResets
+       << " dagFailures=" << s.dagFailures << " lastSeen=" << s.lastSeen;
+    return os.str();
+}
+
+/*
+ * Read once, the store owns the file from then on
+ */
+void SQRLStateStore::load()
+{
+    if (_loaded)
+        return;
+    _loaded = true;
+
+    ifstream ifs(_path);
+    string line;
+    while (getline(ifs, line))
+    {
+        boost::trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+        string key;
+        SQRLDeviceState state;
+        if (parseLine(line, key, state))
+            _states[key] = state;
+    }
+}
+
+/*
+ * Forces what was written to path onto the disk. A directory works too on
+ * POSIX, which makes a rename inside it durable. Windows has no directory sync
+ */
+static bool syncPath(const string& path, bool directory)
+{
+#ifdef _WIN32
+    if (directory)
+        return true;
+    int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0)
+        return false;
+    bool ok = _commit(fd) == 0;
+    _close(fd);
+    return ok;
+#else
+    int fd = open(path.c_str(), directory ? O_RDONLY : O_WRONLY);
+    if (fd < 0)
+        return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
+}
+
+bool SQRLStateStore::save()
+{
+    string tmpPath = _path + ".tmp";
+    {
+        ofstream ofs(tmpPath, ios_base::trunc);
+        if (!ofs.is_open())
+            return false;
+        for (auto const& state : _states)
+            ofs << formatLine(state.first, state.second) << "\n";
+        ofs.flush();
+        if (!ofs.good())
+            return false;
+    }
+
+    // The data must be on disk before the rename is, or a power loss can keep
+    // the rename and lose the data
+    boost::system::error_code ec;
+    if (!syncPath(tmpPath, false))
+    {
+        boost::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    boost::filesystem::rename(tmpPath, _path, ec);
+    if (ec)
+    {
+        boost::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    string dir = boost::filesystem::path(_path).parent_path().string();
+    syncPath(dir.empty() ? "." : dir, true);
+    return true;
+}
+
+bool SQRLStateStore::find(const string& key, SQRLDeviceState& state)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    load();
+    auto it = _states.find(key);
+    if (it == _states.end())
+        return false;
+    state = it->second;
+    return true;
+}
+
+/*
+ * Applies change to the record of key, creating it if needed, and writes the
+ * store out. False if the file could not be written - the change is kept in
+ * memory and goes out with the next successful update
+ */
+bool SQRLStateStore::update(const string& key, const function<void(SQRLDeviceState&)>& change)
+{
+    if (key.empty())
+        return false;
+    std::lock_guard<std::mutex> l(_mutex);
+    load();
+    change(_states[key]);
+    return save();
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace dev
+{
+namespace eth
+{
+// What is known about one board across runs, keyed by DNA_bitstream
+struct SQRLDeviceState
+{
+    // Configuration the board was last left in, for warm re-attach
+    int epoch = -1;
+    double clock = 0;
+    unsigned patience = 0;
+    unsigned intensityN = 0;
+    unsigned intensityD = 0;
+    unsigned fkVCCINT = 0;
+    unsigned jcVCCINT = 0;
+
+    // Outcome of the last finished auto-tune, only valid at the voltages it ran at
+    double tunedClock = 0;  // 0 = never tuned
+    unsigned tunedPatience = 0;
+    unsigned tunedIntensityN = 0;
+    unsigned tunedIntensityD = 0;
+    unsigned tunedFkVCCINT = 0;
+    unsigned tunedJcVCCINT = 0;
+    unsigned tunedFkVout = 0;  // VCCINT in mV stage 4 settled on, 0 if it did not run
+    unsigned tunedJcVout = 0;
+
+    // Last clock that ran with an error rate surely under what the tuner accepts
+    double goodClock = 0;
+    unsigned goodFkVCCINT = 0;
+    unsigned goodJcVCCINT = 0;
+
+    // History
+    uint64_t goodShares = 0;
+    uint64_t failedShares = 0;
+    unsigned sessions = 0;  // Device inits
+    unsigned initFailures = 0;
+    unsigned stallResets = 0;
+    unsigned dagFailures = 0;  // DAG verification failures
+    int64_t lastSeen = 0;      // Unix time of the last init
+
+    double errorRate() const
+    {
+        uint64_t total = goodShares + failedShares;
+        return total ? (double)failedShares / total : 0;
+    }
+};
+
+/*
+ * Device state of every board in one file, a line per board:
+ *   DNA_bitstream key=value key=value ...
+ * Unknown keys are skipped so an older build still reads what a newer one
+ * wrote. Each update writes the whole store to a temporary file, syncs it to
+ * disk and then renames it over the old one - a crash or power loss never
+ * leaves it half written. Lines in the older comma separated state layout are still read
+ */
+class SQRLStateStore
+{
+private:
+    std::string _path;
+    std::mutex _mutex;
+    std::map<std::string, SQRLDeviceState> _states;
+    bool _loaded = false;
+
+    void load();
+    bool save();
+
+public:
+    explicit SQRLStateStore(const std::string& path) : _path(path) {}
+
+    // One store per file, shared by all miners using it
+    static SQRLStateStore& open(const std::string& path);
+
+    bool find(const std::string& key, SQRLDeviceState& state);
+    bool update(const std::string& key, const std::function<void(SQRLDeviceState&)>& change);
+};
+
+}  // namespace eth
+}  // namespace dev
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cmath>
+
+#include "ThermalGovernor.h"
+
+using namespace std;
+using namespace dev;
+using namespace eth;
+
+
+#define sqrllog clog(SQRLChannel)
+
+// Telemetry refreshes the temperatures every few seconds, no point acting faster
+static const double thermalUpdateSeconds = 10;
+// Derate per degree above the band, per degree second, and per degree/second of rise
+static const double thermalKp = 0.02;
+static const double thermalKi = 0.001;
+static const double thermalKd = 0.1;
+// Smallest derate change worth a search restart
+static const double thermalApplyStep = 0.02;
+// Seconds saturated and still hot before a clock step down, cool before one up
+static const double thermalClockDownSeconds = 60;
+static const double thermalClockUpSeconds = 300;
+// Power limit loop - derate per fraction over the limit and per fraction second,
+// the band held still, and the headroom needed before a clock step up
+static const double powerKp = 0.5;
+static const double powerKi = 0.02;
+static const double powerBand = 0.02;
+static const double powerClockUpMargin = 0.1;
+
+ThermalGovernor::ThermalGovernor(SQRLMiner* minerInstance)
+{
+    _minerInstance = minerInstance;
+    _settings = _minerInstance->getSQsettigns();
+}
+
+/*
+ * Degrees above target of the sensor closest to (or furthest past) its target
+ */
+double ThermalGovernor::error(const uint8_t* temps)
+{
+    double e = -1e9;
+    if (_settings->thermalCoreTarget != 0)
+        e = max(e, (double)temps[0] - _settings->thermalCoreTarget);
+    if (_settings->thermalHBMTarget != 0)
+        e = max(e, (double)max(temps[1], temps[2]) - _settings->thermalHBMTarget);
+    return e;
+}
+
+ThermalAction ThermalGovernor::update(
+    const uint8_t* temps, double power, double elapsedSeconds, double clk)
+{
+    bool thermal = _settings->thermalCoreTarget != 0 || _settings->thermalHBMTarget != 0;
+    double powerLimit = _powerLimit;
+
+    _elapsed += elapsedSeconds;
+    if (_elapsed < thermalUpdateSeconds || (thermal && temps[0] == 0))  // No telemetry yet
+        return ThermalAction::None;
+    double dt = _elapsed;
+    _elapsed = 0;
+
+    double maxDerate = _settings->thermalMaxDerate / 100.0;
+    double hysteresis = _settings->thermalHysteresis;
+
+    // Temperature loop - distance outside the band, 0 within it
+    double banded = 0;
+    double thermalDerate = 0;
+    if (thermal)
+    {
+        double e = error(temps);
+        if (e > hysteresis)
+            banded = e - hysteresis;
+        else if (e < -hysteresis)
+            banded = e + hysteresis;
+
+        double derivative = _hasLastError ? (e - _lastError) / dt : 0;
+        _lastError = e;
+        _hasLastError = true;
+
+        // Clamping the integral to the output range keeps it from winding up
+        _integral = min(max(_integral + thermalKi * banded * dt, 0.0), maxDerate);
+        thermalDerate = _integral;
+        if (banded != 0)
+            thermalDerate += thermalKp * banded + thermalKd * derivative;
+    }
+    else
+    {
+        _integral = 0;
+        _hasLastError = false;
+    }
+
+    // Power loop - fraction over the farm's limit outside the band
+    double powerBanded = 0;
+    double powerDerate = 0;
+    if (powerLimit > 0 && power > 0)
+    {
+        double e = (power - powerLimit) / powerLimit;
+        if (e > powerBand)
+            powerBanded = e - powerBand;
+        else if (e < -powerBand)
+            powerBanded = e + powerBand;
+        _powerIntegral = min(max(_powerIntegral + powerKi * powerBanded * dt, 0.0), maxDerate);
+        powerDerate = _powerIntegral;
+        if (powerBanded > 0)
+            powerDerate += powerKp * powerBanded;
+    }
+    else
+    {
+        _powerIntegral = 0;
+    }
+
+    _derate = min(max(max(thermalDerate, powerDerate), 0.0), maxDerate);
+
+    bool over = banded > 0 || powerBanded > 0;
+    // Room for a step up - cool, and comfortably under any power limit
+    bool under = (!thermal || banded < 0) &&
+                 (powerLimit <= 0 || power <= 0 || power < powerLimit * (1 - powerClockUpMargin));
+    if (_derate >= maxDerate && over)
+        _hotSeconds += dt;
+    else
+        _hotSeconds = 0;
+    if (_clockSteps && _derate == 0 && _appliedDerate == 0 && under)
+        _coolSeconds += dt;
+    else
+        _coolSeconds = 0;
+
+    std::stringstream readings;
+    if (thermal)
+        readings << "core " << (int)temps[0] << "C HBM " << (int)temps[1] << "/"
+                     << (int)temps[2] << "C";
+    if (powerLimit > 0)
+        readings << (thermal ? " " : "") << "power " << (int)power << "W of "
+                     << (int)powerLimit << "W";
+
+    if (_hotSeconds >= thermalClockDownSeconds)
+    {
+        _hotSeconds = 0;
+        sqrllog << EthOrange << "Thermal: " << readings.str() << " with intensity derated "
+                << (int)(_appliedDerate * 100) << "% for " << (int)thermalClockDownSeconds
+                << "s, stepping clock down from " << clk << "MHz" << EthReset;
+        return ThermalAction::ClockDown;
+    }
+    if (_coolSeconds >= thermalClockUpSeconds)
+    {
+        _coolSeconds = 0;
+        sqrllog << EthOrange << "Thermal: " << readings.str() << ", stepping clock up from "
+                << clk << "MHz" << EthReset;
+        return ThermalAction::ClockUp;
+    }
+
+    if (fabs(_derate - _appliedDerate) >= thermalApplyStep ||
+        (_derate == 0 && _appliedDerate != 0) || (_derate == maxDerate && _appliedDerate != maxDerate))
+    {
+        sqrllog << EthOrange << "Thermal: " << readings.str() << ", throughput derate "
+                << (int)round(_appliedDerate * 100) << "% -> " << (int)round(_derate * 100) << "%"
+                << EthReset;
+        _appliedDerate = _derate;
+        return ThermalAction::Intensity;
+    }
+    return ThermalAction::None;
+}
+
+/*
+ * Forgets the loop state, the derate goes with the next search start. The
+ * tuner owns clock and intensity while it runs
+ */
+void ThermalGovernor::reset()
+{
+    if (_appliedDerate != 0 || _clockSteps != 0)
+        sqrllog << "Thermal: tuner active, governor released";
+    _derate = 0;
+    _appliedDerate = 0;
+    _integral = 0;
+    _powerIntegral = 0;
+    _hasLastError = false;
+    _elapsed = 0;
+    _clockSteps = 0;
+    _baseClock = 0;
+    _hotSeconds = 0;
+    _coolSeconds = 0;
+}
+
+/*
+ * Told by the miner after it stepped the clock for a ClockDown / ClockUp from
+ * fromClk. A step down takes enough heat out to hand back half the intensity
+ */
+void ThermalGovernor::clockChanged(ThermalAction action, double fromClk)
+{
+    if (action == ThermalAction::ClockDown)
+    {
+        if (_clockSteps++ == 0)
+            _baseClock = fromClk;
+        _integral /= 2;
+        _powerIntegral /= 2;
+    }
+    else if (action == ThermalAction::ClockUp && _clockSteps > 0)
+    {
+        _clockSteps--;
+    }
+}
+
+/*
+ * Intensity closest to the configured throughput less the derate. D only has
+ * 6 bits, N 8
+ */
+void ThermalGovernor::effectiveIntensity(unsigned baseN, unsigned baseD, unsigned& n, unsigned& d)
+{
+    n = baseN;
+    d = baseD;
+    if (_appliedDerate <= 0)
+        return;
+
+    double base = baseN ? (double)baseN / (baseN + baseD) : 1.0;
+    double target = base * (1 - _appliedDerate);
+    double best = 2;
+    for (unsigned cd = 1; cd <= 63; cd++)
+    {
+        unsigned cn = (unsigned)lround(target * cd / (1 - target));
+        if (cn < 1 || cn > 255)
+            continue;
+        double diff = fabs((double)cn / (cn + cd) - target);
+        if (diff < best)
+        {
+            best = diff;
+            n = cn;
+            d = cd;
+        }
+    }
+}
+
+string ThermalGovernor::status()
+{
+    std::stringstream s;
+    s << "-" << (int)round(_appliedDerate * 100) << "%";
+    if (_clockSteps)
+        s << " -" << _clockSteps << "clk";
+    if (_powerLimit > 0)
+        s << " <" << (int)_powerLimit << "W";
+    return s.str();
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "SQRLMiner.h"
+
+namespace dev
+{
+namespace eth
+{
+// What the governor wants done after an update
+enum class ThermalAction : uint8_t
+{
+    None,
+    Intensity,  // Derate changed - restart the search to program the new intensity
+    ClockDown,  // Intensity derate is exhausted, one clock step down
+    ClockUp     // Cool again, one step back towards the clock before the governor
+};
+
+class SQRLMiner;
+
+/*
+ * Holds core and HBM temperatures at their targets (--sqrl-thermal-*) and the
+ * board's draw under the limit the farm's power budget gives it. A PID loop on
+ * temperature and a PI loop on power each ask for part of the configured
+ * intensity throughput to be given up, the larger one wins. Only once that
+ * derate is at its limit and the board is still too hot or hungry does the
+ * clock come down a step. Within the band around each target the output is
+ * held, so the intensity is not reprogrammed on every bit of sensor noise
+ */
+class ThermalGovernor
+{
+private:
+    SQRLMiner* _minerInstance = NULL;
+    SQSettings* _settings = NULL;
+
+    double _derate = 0;         // Fraction of throughput removed, what the PID asks for
+    double _appliedDerate = 0;  // What the hashcore was last programmed with
+    double _integral = 0;
+    double _powerIntegral = 0;
+    atomic<double> _powerLimit = {0};  // Watts, set by the farm's power budget
+    double _lastError = 0;
+    bool _hasLastError = false;
+    double _elapsed = 0;  // Seconds since the last update
+
+    // Clock steps taken down and the clock they started from
+    unsigned _clockSteps = 0;
+    double _baseClock = 0;
+    double _hotSeconds = 0;   // Saturated and still above the band
+    double _coolSeconds = 0;  // Below the band with no derate
+
+    double error(const uint8_t* temps);
+
+public:
+    ThermalGovernor(SQRLMiner* minerInstance);
+    ~ThermalGovernor(){};
+
+    // Also while a derate or clock step is left over from a limit since lifted
+    bool enabled()
+    {
+        return _settings->thermalCoreTarget != 0 || _settings->thermalHBMTarget != 0 ||
+               _powerLimit > 0 || _appliedDerate > 0 || _clockSteps > 0;
+    }
+    ThermalAction update(const uint8_t* temps, double power, double elapsedSeconds, double clk);
+    void setPowerLimit(double watts) { _powerLimit = watts; }
+    double getPowerLimit() { return _powerLimit; }
+    void reset();
+    void clockChanged(ThermalAction action, double clk);
+
+    void effectiveIntensity(unsigned baseN, unsigned baseD, unsigned& n, unsigned& d);
+    double getDerate() { return _appliedDerate; }
+    double getBaseClock() { return _clockSteps ? _baseClock : 0; }
+    string status();
+};
+
+
+}  // namespace eth
+}  // namespace dev
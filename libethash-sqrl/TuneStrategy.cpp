@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+
+#include "TuneStrategy.h"
+
+using namespace std;
+using namespace dev;
+using namespace eth;
+
+// First round sample size, and the fraction kept after each round
+static const unsigned halvingCandidates = 27;
+static const unsigned halvingEta = 3;
+// How far over its throughput model a measurement may come out
+static const double halvingModelSlack = 1.05;
+// Ladder steps below the starting clock worth trying
+static const unsigned halvingStepsBelowStart = 4;
+// Same throughput range as the staged tune's first intensity pass
+static const double halvingThroughputs[] = {0.6, 0.65, 0.7, 0.75, 0.8, 0.85, 0.9, 0.92};
+
+string TuneCandidate::to_string() const
+{
+    ostringstream s;
+    s << clock << "MHz P=" << patience << " N=" << intensityN << " D=" << intensityD;
+    return s.str();
+}
+
+unique_ptr<TuneStrategy> TuneStrategy::create(TuneStrategyType type, const TuneSpace& space)
+{
+    switch (type)
+    {
+    case TuneStrategyType::SuccessiveHalving:
+        return unique_ptr<TuneStrategy>(new SuccessiveHalvingStrategy(space));
+    default:
+        return nullptr;
+    }
+}
+
+SuccessiveHalvingStrategy::SuccessiveHalvingStrategy(const TuneSpace& space)
+  : _seconds(space.seconds), _start(space.start), _best(space.start)
+{
+    sample(space);
+}
+
+static bool sameSettings(const TuneCandidate& a, const TuneCandidate& b)
+{
+    return (int)a.clock == (int)b.clock && a.patience == b.patience &&
+           a.intensityN == b.intensityN && a.intensityD == b.intensityD;
+}
+
+/*
+ * Clocks are spread evenly over the ladder, throughput targets shuffled across
+ * them so each shows up about as often at low and high clocks
+ */
+void SuccessiveHalvingStrategy::sample(const TuneSpace& space)
+{
+    vector<double> clocks;
+    size_t startIndex = 0;
+    for (size_t i = 0; i < space.clocks.size(); i++)
+        if (fabs(space.clocks[i] - space.start.clock) < fabs(space.clocks[startIndex] - space.start.clock))
+            startIndex = i;
+    for (size_t i = startIndex > halvingStepsBelowStart ? startIndex - halvingStepsBelowStart : 0;
+         i < space.clocks.size(); i++)
+        clocks.push_back(space.clocks[i]);
+
+    _round.push_back(_start);
+    if (clocks.empty())
+        return;
+
+    size_t count = space.tuneIntensity ? halvingCandidates : min((size_t)halvingCandidates, clocks.size());
+    mt19937 rng(space.seed);
+    size_t throughputCount = sizeof(halvingThroughputs) / sizeof(halvingThroughputs[0]);
+    vector<size_t> throughputs(count);
+    for (size_t i = 0; i < count; i++)
+        throughputs[i] = i % throughputCount;
+    shuffle(throughputs.begin(), throughputs.end(), rng);
+
+    unsigned baseD = space.start.intensityD ? space.start.intensityD : 3;
+    for (size_t i = 0; i < count; i++)
+    {
+        TuneCandidate c = _start;
+        c.clock = clocks[count > 1 ? i * (clocks.size() - 1) / (count - 1) : clocks.size() - 1];
+        if (space.tuneIntensity)
+        {
+            double t = halvingThroughputs[throughputs[i]];
+            c.intensityD = (rng() % 2) ? baseD : min(63u, baseD * 2);
+            c.intensityN = (unsigned)max(1L, min(255L, lround(c.intensityD * t / (1 - t))));
+            c.patience = 1 + rng() % 4;
+        }
+        if (none_of(_round.begin(), _round.end(),
+                [&](const TuneCandidate& o) { return sameSettings(o, c); }))
+            _round.push_back(c);
+    }
+
+    // Highest model bound first, the rest can often be ruled out unmeasured
+    stable_sort(_round.begin(), _round.end(), [](const TuneCandidate& a, const TuneCandidate& b) {
+        return a.modelHashrate() > b.modelHashrate();
+    });
+}
+
+bool SuccessiveHalvingStrategy::next(TuneCandidate& candidate, unsigned& seconds)
+{
+    while (!_done)
+    {
+        while (_next < _round.size())
+        {
+            TuneCandidate& c = _round[_next];
+            double measured = -1;
+            for (size_t i = 0; i < _next; i++)
+                measured = max(measured, _round[i].score);
+            // Measurements run a little over the model with timing jitter
+            if (!_finalRound && c.modelHashrate() * halvingModelSlack < measured)
+            {
+                c.score = -1;
+                _next++;
+                continue;
+            }
+            candidate = c;
+            seconds = _seconds;
+            return true;
+        }
+        if (!promote())
+            _done = true;
+    }
+    return false;
+}
+
+void SuccessiveHalvingStrategy::report(const TuneCandidate& measured)
+{
+    if (_next < _round.size())
+        _round[_next++] = measured;
+}
+
+/*
+ * Ends a round, false once the search is over. A final candidate whose long
+ * run fails gives way to the next best of the earlier round
+ */
+bool SuccessiveHalvingStrategy::promote()
+{
+    vector<TuneCandidate> feasible;
+    for (auto const& c : _round)
+        if (c.score >= 0)
+            feasible.push_back(c);
+    stable_sort(feasible.begin(), feasible.end(),
+        [](const TuneCandidate& a, const TuneCandidate& b) { return a.score > b.score; });
+
+    _next = 0;
+    if (_finalRound)
+    {
+        if (!feasible.empty())
+        {
+            _best = feasible[0];
+            return false;
+        }
+        _best = _start;
+        if (_reserve.empty())
+            return false;
+        _round.assign(1, _reserve.front());
+        _reserve.erase(_reserve.begin());
+        _round[0].score = -1;
+        return true;
+    }
+
+    if (feasible.empty())
+    {
+        _best = _start;
+        return false;
+    }
+
+    size_t keep = max((size_t)1, feasible.size() / halvingEta);
+    _reserve.assign(feasible.begin() + keep, feasible.end());
+    _round.assign(feasible.begin(), feasible.begin() + keep);
+    _best = _round[0];
+    _finalRound = keep == 1;
+    _seconds *= halvingEta;
+    _roundIndex++;
+    for (auto& c : _round)
+        c.score = -1;
+    stable_sort(_round.begin(), _round.end(), [](const TuneCandidate& a, const TuneCandidate& b) {
+        return a.modelHashrate() > b.modelHashrate();
+    });
+    return true;
+}
+
+string SuccessiveHalvingStrategy::progress()
+{
+    ostringstream s;
+    s << (_finalRound ? "final round" : "round " + std::to_string(_roundIndex + 1)) << ", "
+      << min(_next + 1, _round.size()) << "/" << _round.size() << ", " << _seconds << "s each";
+    return s.str();
+}
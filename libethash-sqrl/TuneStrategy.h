@@ -0,0 +1,102 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dev
+{
+namespace eth
+{
+// Search strategies for AutoTuner (--tune-strategy)
+enum class TuneStrategyType : unsigned
+{
+    Staged = 0,            // Clock, error rate then intensity, one after the other (built in)
+    SuccessiveHalving = 1  // Sampled clock x N x D x P, measured ever longer
+};
+
+// One point of the search space and how it measured
+struct TuneCandidate
+{
+    double clock = 0;
+    unsigned patience = 0;
+    unsigned intensityN = 0;
+    unsigned intensityD = 0;
+
+    double hashrate = 0;   // Hashes per second measured
+    double errorRate = 0;  // Over the measurement
+    double score = -1;     // Error penalized hashrate, below 0 if infeasible or not measured
+
+    double throughput() const
+    {
+        return intensityN ? (double)intensityN / (intensityN + intensityD) : 1.0;
+    }
+    // Upper bound of the hashrate the throughput model allows
+    double modelHashrate() const { return clock / 8 * throughput() * 1e6; }
+    std::string to_string() const;
+};
+
+// What a strategy may search
+struct TuneSpace
+{
+    std::vector<double> clocks;  // Reachable ladder steps, lowest first
+    TuneCandidate start;         // Configured or current operating point
+    bool tuneIntensity = false;  // Else only the clock is searched
+    unsigned seconds = 60;       // Base measurement time of one candidate
+    unsigned seed = 0;
+};
+
+/*
+ * A search over tuning candidates. The tuner asks for the next candidate,
+ * runs it for the time asked and reports how it measured, until next() says
+ * the search is over and best() holds the result
+ */
+class TuneStrategy
+{
+public:
+    virtual ~TuneStrategy() {}
+
+    virtual const char* name() = 0;
+    virtual bool next(TuneCandidate& candidate, unsigned& seconds) = 0;
+    virtual void report(const TuneCandidate& measured) = 0;
+    virtual TuneCandidate best() = 0;
+    virtual std::string progress() = 0;
+
+    // Nothing for the built in staged tune
+    static std::unique_ptr<TuneStrategy> create(TuneStrategyType type, const TuneSpace& space);
+};
+
+/*
+ * Successive halving - a sample of the space spread over clock, throughput,
+ * D and patience is measured briefly, the best third goes on to a measurement
+ * three times as long, and so on until one is left, which gets a final long
+ * run to confirm its error rate. Candidates whose throughput model cannot beat
+ * what was already measured in the same round are skipped without measuring
+ */
+class SuccessiveHalvingStrategy : public TuneStrategy
+{
+private:
+    std::vector<TuneCandidate> _round;
+    std::vector<TuneCandidate> _reserve;  // Feasible ones dropped by the last round, best first
+    size_t _next = 0;
+    unsigned _seconds;
+    unsigned _roundIndex = 0;
+    bool _finalRound = false;
+    bool _done = false;
+    TuneCandidate _start;
+    TuneCandidate _best;
+
+    void sample(const TuneSpace& space);
+    bool promote();
+
+public:
+    explicit SuccessiveHalvingStrategy(const TuneSpace& space);
+
+    const char* name() override { return "successive halving"; }
+    bool next(TuneCandidate& candidate, unsigned& seconds) override;
+    void report(const TuneCandidate& measured) override;
+    TuneCandidate best() override { return _best; }
+    std::string progress() override;
+};
+
+}  // namespace eth
+}  // namespace dev
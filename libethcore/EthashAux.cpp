@@ -17,17 +17,51 @@
 
 #include "EthashAux.h"
 
+#include <map>
+#include <mutex>
+
 #include <ethash/ethash.hpp>
 
 using namespace dev;
 using namespace eth;
 
+namespace
+{
+std::mutex s_preparedMutex;
+std::map<int, std::shared_ptr<const ethash::epoch_context>> s_prepared;
+}  // namespace
+
 Result EthashAux::eval(int epoch, h256 const& _headerHash, uint64_t _nonce) noexcept
 {
     auto headerHash = ethash::hash256_from_bytes(_headerHash.data());
-    auto& context = ethash::get_global_epoch_context(epoch);
-    auto result = ethash::hash(context, headerHash, _nonce);
+    auto prepared = findEpoch(epoch);
+    auto result = prepared ? ethash::hash(*prepared, headerHash, _nonce) :
+                             ethash::hash(ethash::get_global_epoch_context(epoch), headerHash, _nonce);
     h256 mix{reinterpret_cast<byte*>(result.mix_hash.bytes), h256::ConstructFromPointer};
     h256 final{reinterpret_cast<byte*>(result.final_hash.bytes), h256::ConstructFromPointer};
     return {final, mix};
-}
\ No newline at end of file
+}
+std::shared_ptr<const ethash::epoch_context> EthashAux::prepareEpoch(int epoch)
+{
+    auto context = findEpoch(epoch);
+    if (context)
+        return context;
+
+    // Built outside the lock as it takes a while
+    context = std::shared_ptr<const ethash::epoch_context>(ethash::create_epoch_context(epoch));
+    if (!context)
+        return nullptr;
+
+    std::lock_guard<std::mutex> l(s_preparedMutex);
+    for (auto it = s_prepared.begin(); it != s_prepared.end();)
+        it = (it->first < epoch - 1) ? s_prepared.erase(it) : std::next(it);
+    s_prepared[epoch] = context;
+    return context;
+}
+
+std::shared_ptr<const ethash::epoch_context> EthashAux::findEpoch(int epoch)
+{
+    std::lock_guard<std::mutex> l(s_preparedMutex);
+    auto it = s_prepared.find(epoch);
+    return (it == s_prepared.end()) ? nullptr : it->second;
+}
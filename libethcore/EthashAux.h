@@ -37,6 +37,13 @@ class EthashAux
 {
 public:
     static Result eval(int epoch, h256 const& _headerHash, uint64_t _nonce) noexcept;
+
+    // Builds the context of an epoch ahead of time without evicting the global one.
+    // The previous epoch's context is retained so late shares can still be evaluated.
+    static std::shared_ptr<const ethash::epoch_context> prepareEpoch(int epoch);
+
+    // Returns the pre-staged context of an epoch or nullptr if it was never prepared
+    static std::shared_ptr<const ethash::epoch_context> findEpoch(int epoch);
 };
 
 struct EpochContext
@@ -78,6 +85,7 @@ struct Solution
     WorkPackage work;                              // WorkPackage this solution refers to
     std::chrono::steady_clock::time_point tstamp;  // Timestamp of found solution
     unsigned midx;                                 // Originating miner Id
+    h256 healthTarget;                             // Target the device reported against, if any
 };
 
 }  // namespace eth
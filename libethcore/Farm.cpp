@@ -55,6 +55,9 @@ Farm::Farm(std::map<std::string, DeviceDescriptor>& _DevicesCollection,
 
     m_this = this;
 
+    HashRateStats::setOutlierPolicy(
+        (StatsOutlierMode)min(m_Settings.statsOutliers, 2u), m_Settings.statsOutlierFactor);
+
     // Init HWMON if needed
     if (m_Settings.hwMon)
     {
@@ -197,6 +200,10 @@ Farm::~Farm()
     // Stop mining (if needed)
     if (m_isMining.load(std::memory_order_relaxed))
         stop();
+    joinTracked();
+
+    if (m_prestageThread.joinable())
+        m_prestageThread.join();
 
     DEV_BUILD_LOG_PROGRAMFLOW(cnote, "Farm::~Farm() end");
 }
@@ -222,14 +229,17 @@ void Farm::setWork(WorkPackage const& _newWp)
     // Retrieve appropriate EpochContext
     if (m_currentWp.epoch != _newWp.epoch)
     {
-        ethash::epoch_context _ec = ethash::get_global_epoch_context(_newWp.epoch);
-        m_currentEc.epochNumber = _newWp.epoch;
-        m_currentEc.lightNumItems = _ec.light_cache_num_items;
-        m_currentEc.lightSize = ethash::get_light_cache_size(_ec.light_cache_num_items);
-        m_currentEc.dagNumItems = _ec.full_dataset_num_items;
-        m_currentEc.dagSize = ethash::get_full_dataset_size(_ec.full_dataset_num_items);
-        m_currentEc.lightCache = _ec.light_cache;
-	m_currentEc.seed = ethash::calculate_epoch_seed(_newWp.epoch);
+        // Wait for a pre-staging of this very epoch still in flight, it's closer to done
+        // than a fresh build would be
+        if (m_prestageEpoch == _newWp.epoch && m_prestageThread.joinable())
+            m_prestageThread.join();
+
+        m_currentContext = EthashAux::findEpoch(_newWp.epoch);
+        if (m_currentContext)
+            m_currentEc = makeEpochContext(_newWp.epoch, *m_currentContext);
+        else
+            m_currentEc =
+                makeEpochContext(_newWp.epoch, ethash::get_global_epoch_context(_newWp.epoch));
 
         for (auto const& miner : m_miners)
             miner->setEpoch(m_currentEc);
@@ -241,27 +251,74 @@ void Farm::setWork(WorkPackage const& _newWp)
     if (m_Settings.ergodicity == 2 && m_currentWp.exSizeBytes == 0)
         shuffle();
 
-    uint64_t _startNonce;
     if (m_currentWp.exSizeBytes > 0)
     {
-        // Equally divide the residual segment among miners
-        _startNonce = m_currentWp.startNonce;
+        // Equally divide the residual segment among miner slots
+        m_currentStartNonce = m_currentWp.startNonce;
+        size_t slots = std::max<size_t>(m_telemetry.miners.size(), 1);
         m_nonce_segment_with =
-            (unsigned int)log2(pow(2, 64 - (m_currentWp.exSizeBytes * 4)) / m_miners.size());
+            (unsigned int)log2(pow(2, 64 - (m_currentWp.exSizeBytes * 4)) / slots);
     }
     else
     {
         // Get the randomly selected nonce
-        _startNonce = m_nonce_scrambler;
+        m_currentStartNonce = m_nonce_scrambler;
     }
 
-    for (unsigned int i = 0; i < m_miners.size(); i++)
+    for (auto const& miner : m_miners)
+        assignWork(miner);
+
+    // Prepare the next epoch once we're close enough to its boundary.
+    // Block number is only known with some stratum flavours
+    if (m_Settings.epochPrestage && _newWp.block > 0)
     {
-        m_currentWp.startNonce = _startNonce + ((uint64_t)i << m_nonce_segment_with);
-        m_miners.at(i)->setWork(m_currentWp);
+        int nextEpoch = _newWp.epoch + 1;
+        int blocksLeft = nextEpoch * ethash::epoch_length - _newWp.block;
+        if (blocksLeft <= (int)m_Settings.epochPrestage && m_prestageEpoch != nextEpoch)
+        {
+            if (m_prestageThread.joinable())
+                m_prestageThread.join();
+            m_prestageEpoch = nextEpoch;
+            m_prestageThread = std::thread(&Farm::prestageEpoch, this, nextEpoch, m_miners);
+        }
     }
 }
 
+EpochContext Farm::makeEpochContext(int _epoch, const ethash::epoch_context& _ec)
+{
+    EpochContext ec;
+    ec.epochNumber = _epoch;
+    ec.lightNumItems = _ec.light_cache_num_items;
+    ec.lightSize = ethash::get_light_cache_size(_ec.light_cache_num_items);
+    ec.dagNumItems = _ec.full_dataset_num_items;
+    ec.dagSize = ethash::get_full_dataset_size(_ec.full_dataset_num_items);
+    ec.lightCache = _ec.light_cache;
+    ec.seed = ethash::calculate_epoch_seed(_epoch);
+    return ec;
+}
+
+void Farm::prestageEpoch(int _epoch, std::vector<std::shared_ptr<Miner>> _miners)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto context = EthashAux::prepareEpoch(_epoch);
+    if (!context)
+    {
+        cwarn << "Could not pre-stage epoch " << _epoch;
+        return;
+    }
+
+    // Works on a snapshot of the miners as setWork may be waiting on us holding x_minerWork
+    EpochContext ec = makeEpochContext(_epoch, *context);
+    for (auto const& miner : _miners)
+        miner->prestageEpoch(ec);
+
+    cnote << "Epoch " << _epoch << " pre-staged in "
+          << std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::steady_clock::now() - start)
+                 .count()
+          << " ms";
+}
+
 /**
  * @brief Start a number of miners.
  */
@@ -277,64 +334,458 @@ bool Farm::start()
     // Start all subscribed miners if none yet
     if (!m_miners.size())
     {
-        for (auto it = m_DevicesCollection.begin(); it != m_DevicesCollection.end(); it++)
         {
-            TelemetryAccountType minerTelemetry;
+            Guard t(x_telemetry);
+            m_telemetry.miners.clear();
+            m_telemetry.miners.reserve(m_DevicesCollection.size() + m_spareMinerSlots);
+        }
+        m_recovery.clear();
+        for (auto it = m_DevicesCollection.begin(); it != m_DevicesCollection.end(); it++)
+            startMiner(it->second, (unsigned)m_telemetry.miners.size());
+
+        // Initialize DAG Load mode
+        unsigned dagLoadConcurrency = m_Settings.dagLoadConcurrency;
+        if (!dagLoadConcurrency && m_Settings.dagLoadPower && m_Settings.dagLoadWatts)
+            dagLoadConcurrency = m_Settings.dagLoadPower / m_Settings.dagLoadWatts;
+        if (!dagLoadConcurrency)
+            dagLoadConcurrency = (unsigned int)m_miners.size();
+        Miner::setDagLoadInfo(
+            m_Settings.dagLoadMode, (unsigned int)m_miners.size(), dagLoadConcurrency);
+
+        m_isMining.store(true, std::memory_order_relaxed);
+    }
+    else
+    {
+        for (auto const& miner : m_miners)
+            miner->startWorking();
+        m_isMining.store(true, std::memory_order_relaxed);
+    }
+
+    DEV_BUILD_LOG_PROGRAMFLOW(cnote, "Farm::start() end");
+    return m_isMining.load(std::memory_order_relaxed);
+}
+
+std::shared_ptr<Miner> Farm::startMiner(DeviceDescriptor& _device, unsigned index)
+{
+    TelemetryAccountType minerTelemetry;
+    std::shared_ptr<Miner> miner;
 #if ETH_ETHASHCUDA
-            if (it->second.subscriptionType == DeviceSubscriptionTypeEnum::Cuda)
-            {
-                minerTelemetry.prefix = "cu";
-                m_miners.push_back(std::shared_ptr<Miner>(
-                    new CUDAMiner(m_miners.size(), m_CUSettings, it->second)));
-            }
+    if (_device.subscriptionType == DeviceSubscriptionTypeEnum::Cuda)
+    {
+        minerTelemetry.prefix = "cu";
+        miner = std::shared_ptr<Miner>(new CUDAMiner(index, m_CUSettings, _device));
+    }
 #endif
 #if ETH_ETHASHCL
 
-            if (it->second.subscriptionType == DeviceSubscriptionTypeEnum::OpenCL)
-            {
-                minerTelemetry.prefix = "cl";
-                m_miners.push_back(std::shared_ptr<Miner>(
-                    new CLMiner(m_miners.size(), m_CLSettings, it->second)));
-            }
+    if (_device.subscriptionType == DeviceSubscriptionTypeEnum::OpenCL)
+    {
+        minerTelemetry.prefix = "cl";
+        miner = std::shared_ptr<Miner>(new CLMiner(index, m_CLSettings, _device));
+    }
 #endif
 #if ETH_ETHASHCPU
 
-            if (it->second.subscriptionType == DeviceSubscriptionTypeEnum::Cpu)
-            {
-                minerTelemetry.prefix = "cp";
-                m_miners.push_back(std::shared_ptr<Miner>(
-                    new CPUMiner(m_miners.size(), m_CPSettings, it->second)));
-            }
+    if (_device.subscriptionType == DeviceSubscriptionTypeEnum::Cpu)
+    {
+        minerTelemetry.prefix = "cp";
+        miner = std::shared_ptr<Miner>(new CPUMiner(index, m_CPSettings, _device));
+    }
 #endif
 #if ETH_ETHASHSQRL
 
-            if (it->second.subscriptionType == DeviceSubscriptionTypeEnum::Sqrl)
-            {
-                minerTelemetry.prefix = "sq";
-                m_miners.push_back(std::shared_ptr<Miner>(
-                    new SQRLMiner(m_miners.size(), m_SQSettings, it->second, &m_telemetry)));
-            }
+    if (_device.subscriptionType == DeviceSubscriptionTypeEnum::Sqrl)
+    {
+        minerTelemetry.prefix = "sq";
+        miner = std::shared_ptr<Miner>(new SQRLMiner(index, m_SQSettings, _device));
+    }
 #endif
-            if (minerTelemetry.prefix.empty())
-                continue;
+    if (!miner)
+        return nullptr;
+    {
+        Guard t(x_telemetry);
+        if (index < m_telemetry.miners.size())
+        {
+            // A restarted miner takes over its slot, solutions found so far included
+            minerTelemetry.solutions = m_telemetry.miners.at(index).solutions;
+            m_telemetry.miners.at(index) = minerTelemetry;
+        }
+        else
+        {
             m_telemetry.miners.push_back(minerTelemetry);
-            m_miners.back()->startWorking();
         }
+    }
+    m_miners.insert(std::upper_bound(m_miners.begin(), m_miners.end(), miner,
+                        [](const std::shared_ptr<Miner>& a, const std::shared_ptr<Miner>& b) {
+                            return a->Index() < b->Index();
+                        }),
+        miner);
+    miner->startWorking();
+    return miner;
+}
 
-        // Initialize DAG Load mode
-        Miner::setDagLoadInfo(m_Settings.dagLoadMode, (unsigned int)m_miners.size());
+void Farm::assignWork(const std::shared_ptr<Miner>& _miner)
+{
+    WorkPackage wp = m_currentWp;
+    wp.startNonce = m_currentStartNonce + ((uint64_t)_miner->Index() << m_nonce_segment_with);
+    _miner->setWork(wp);
+}
 
-        m_isMining.store(true, std::memory_order_relaxed);
+void Farm::leaveSerializedDagLoads()
+{
+    // Serialized loads chain on contiguous miner indexes, which no longer holds once
+    // miners come and go. Scheduled with a single slot is still one load at a time
+    if (m_Settings.dagLoadMode == DAG_LOAD_MODE_SEQUENTIAL)
+    {
+        m_Settings.dagLoadMode = DAG_LOAD_MODE_SCHEDULED;
+        m_Settings.dagLoadConcurrency = 1;
+        Miner::setDagLoadInfo(m_Settings.dagLoadMode, (unsigned)m_miners.size(), 1);
     }
-    else
+}
+
+void Farm::joinMiner(const std::shared_ptr<Miner>& _miner)
+{
+    leaveSerializedDagLoads();
+    if (m_paused.load(std::memory_order_relaxed))
+        _miner->pause(MinerPauseEnum::PauseDueToFarmPaused);
+    if (!m_currentWp)
+        return;
+    _miner->setEpoch(m_currentEc);
+
+    // With an extranonce the miner slots share the pool's segment, a new slot
+    // may need narrower segments for everyone
+    if (m_currentWp.exSizeBytes > 0)
     {
+        unsigned width = (unsigned int)log2(
+            pow(2, 64 - (m_currentWp.exSizeBytes * 4)) / m_telemetry.miners.size());
+        if (width != m_nonce_segment_with)
+        {
+            m_nonce_segment_with = width;
+            for (auto const& miner : m_miners)
+                assignWork(miner);
+            return;
+        }
+    }
+    assignWork(_miner);
+}
+
+bool Farm::addSqrlDevice(const std::string& _host, unsigned _port, std::string& _error)
+{
+#if ETH_ETHASHSQRL
+    string hostPort = _host + ":" + to_string(_port);
+    {
+        Guard l(x_minerWork);
+        if (!isMining())
+        {
+            _error = "Not mining";
+            return false;
+        }
+        if (m_telemetry.miners.size() >= m_telemetry.miners.capacity())
+        {
+            _error = "No spare miner slots left, restart to add more devices";
+            return false;
+        }
         for (auto const& miner : m_miners)
-            miner->startWorking();
-        m_isMining.store(true, std::memory_order_relaxed);
+        {
+            DeviceDescriptor d = miner->getDescriptor();
+            if (d.subscriptionType == DeviceSubscriptionTypeEnum::Sqrl && d.sqHost == _host &&
+                d.sqPort == _port)
+            {
+                _error = hostPort + " is mined already by sq" + to_string(miner->Index());
+                return false;
+            }
+        }
     }
 
-    DEV_BUILD_LOG_PROGRAMFLOW(cnote, "Farm::start() end");
-    return m_isMining.load(std::memory_order_relaxed);
+    // Probing takes up to the probe timeout, keep it off the io thread
+    spawnTracked([this, hostPort]() {
+        string dna;
+        if (m_SQSettings.probeTimeoutMs)
+        {
+            SQRLProbeResult r = SQRLMiner::probeHosts({hostPort}, m_SQSettings.probeTimeoutMs)[0];
+            if (!r.reachable)
+            {
+                cwarn << "Not adding " << hostPort << " : unreachable";
+                return;
+            }
+            dna = r.dna;
+        }
+
+        Guard l(x_minerWork);
+        if (!isMining() || m_telemetry.miners.size() >= m_telemetry.miners.capacity())
+        {
+            cwarn << "Not adding " << hostPort << " : farm stopped or out of miner slots";
+            return;
+        }
+        for (auto const& miner : m_miners)
+        {
+            DeviceDescriptor d = miner->getDescriptor();
+            if (d.subscriptionType == DeviceSubscriptionTypeEnum::Sqrl && !dna.empty() &&
+                d.sqDNA == dna)
+            {
+                cwarn << "Not adding " << hostPort << " : same FPGA (DNA " << dna << ") as sq"
+                      << miner->Index();
+                return;
+            }
+        }
+
+        unsigned n = 0;
+        while (m_DevicesCollection.count("sqrl-" + to_string(n)))
+            n++;
+        string uniqueId = "sqrl-" + to_string(n);
+        DeviceDescriptor& device = m_DevicesCollection[uniqueId];
+        SQRLMiner::describeDevice(device, uniqueId, hostPort, dna, m_SQSettings);
+        device.subscriptionType = DeviceSubscriptionTypeEnum::Sqrl;
+
+        auto miner = startMiner(device, (unsigned)m_telemetry.miners.size());
+        joinMiner(miner);
+        cnote << "Added " << device.name << " as sq" << miner->Index();
+    });
+    return true;
+#else
+    (void)_host;
+    (void)_port;
+    _error = "Built without SQRL support";
+    return false;
+#endif
+}
+
+bool Farm::removeMiner(unsigned _index)
+{
+    std::shared_ptr<Miner> miner;
+    {
+        Guard l(x_minerWork);
+        auto it = std::find_if(m_miners.begin(), m_miners.end(),
+            [_index](const std::shared_ptr<Miner>& m) { return m->Index() == _index; });
+        if (it == m_miners.end())
+        {
+            // Down and waiting for the supervisor, just don't bring it back
+            auto r = m_recovery.find(_index);
+            if (r == m_recovery.end() || r->second.uniqueId.empty())
+                return false;
+            m_DevicesCollection.erase(r->second.uniqueId);
+            m_recovery.erase(r);
+            Guard t(x_telemetry);
+            m_telemetry.miners.at(_index).removed = true;
+            cnote << "Removed miner " << _index;
+            return true;
+        }
+        miner = *it;
+        m_miners.erase(it);
+
+        miner->triggerStopWorking();
+        miner->kick_miner();
+        m_DevicesCollection.erase(miner->getDescriptor().uniqueId);
+
+        leaveSerializedDagLoads();
+
+        // The slot stays, solutions still in flight are accounted to it
+        Guard t(x_telemetry);
+        m_telemetry.miners.at(_index).removed = true;
+        m_telemetry.miners.at(_index).hashrate = 0.0f;
+    }
+    cnote << "Removed " << miner->getDescriptor().name;
+
+    // Destruction joins the miner thread, which may be mid DAG load or AXI timeout
+    spawnTracked([miner]() mutable { miner.reset(); });
+    return true;
+}
+
+/**
+ * @brief Counts the task in before its thread starts, so joinTracked can't miss it
+ */
+void Farm::spawnTracked(std::function<void()> _task)
+{
+    {
+        Guard l(x_tracked);
+        m_trackedThreads++;
+    }
+    // Moved, not copied: a teardown's last reference to its miner must go on that thread
+    std::thread([this, task = std::move(_task)]() {
+        task();
+        Guard l(x_tracked);
+        if (--m_trackedThreads == 0)
+            m_trackedDone.notify_all();
+    }).detach();
+}
+
+void Farm::joinTracked()
+{
+    std::unique_lock<Mutex> l(x_tracked);
+    m_trackedDone.wait(l, [this]() { return m_trackedThreads == 0; });
+}
+
+/**
+ * @brief Restarts miners whose worker exited (device init or DAG failure) or made
+ *  no progress for --miner-stuck-timeout, each on its own exponential backoff.
+ *  A miner failing more than --miner-restarts times within an hour is given up
+ */
+void Farm::superviseMiners()
+{
+    if (!m_Settings.minerRestarts || !isMining())
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+    Guard l(x_minerWork);
+
+    for (auto it = m_miners.begin(); it != m_miners.end();)
+    {
+        std::shared_ptr<Miner> miner = *it;
+        MinerRecovery& r = m_recovery[miner->Index()];
+
+        ostringstream why;
+        int64_t age = miner->heartbeatAge();
+        if (miner->isStopped())
+            why << "worker exited";
+        else if (m_Settings.minerStuckTimeout && age > (int64_t)m_Settings.minerStuckTimeout * 1000)
+            why << "no progress for " << age / 1000 << " s";
+        if (why.str().empty())
+        {
+            // Long enough up since the last restart, the next failure backs off from scratch
+            if (r.failuresInRow && now - r.restartedAt > std::chrono::minutes(10))
+                r.failuresInRow = 0;
+            it++;
+            continue;
+        }
+
+        it = m_miners.erase(it);
+        miner->triggerStopWorking();
+        miner->kick_miner();
+        unsigned index = miner->Index();
+        {
+            Guard t(x_telemetry);
+            m_telemetry.miners.at(index).hashrate = 0.0f;
+        }
+
+        r.uniqueId = miner->getDescriptor().uniqueId;
+        r.failuresInRow++;
+        r.restarts.push_back(now);
+        while (!r.restarts.empty() && now - r.restarts.front() > std::chrono::hours(1))
+            r.restarts.pop_front();
+
+        if (r.restarts.size() > m_Settings.minerRestarts)
+        {
+            cwarn << miner->getDescriptor().name << " (" << m_telemetry.miners.at(index).prefix << index << ") " << why.str()
+                  << ", " << r.restarts.size() - 1 << " restarts within the hour - giving up";
+            r.givenUp = true;
+            Guard t(x_telemetry);
+            m_telemetry.miners.at(index).removed = true;
+        }
+        else
+        {
+            auto backoff = std::min(
+                std::chrono::seconds(5) * (1 << std::min(r.failuresInRow - 1, 6u)),
+                std::chrono::seconds(300));
+            r.retryAt = now + backoff;
+            cwarn << miner->getDescriptor().name << " (" << m_telemetry.miners.at(index).prefix << index << ") " << why.str()
+                  << ", restarting in " << backoff.count() << " s";
+        }
+
+        // Destruction joins the worker, which for a stuck one takes until its device
+        // call times out. The replacement waits for it so two never drive one device
+        r.tornDown = std::make_shared<std::atomic<bool>>(false);
+        spawnTracked([miner, done = r.tornDown]() mutable {
+            miner.reset();
+            *done = true;
+        });
+    }
+
+    for (auto& kv : m_recovery)
+    {
+        MinerRecovery& r = kv.second;
+        if (r.givenUp || !r.tornDown || !*r.tornDown || now < r.retryAt)
+            continue;
+        r.tornDown.reset();
+
+        auto device = m_DevicesCollection.find(r.uniqueId);
+        if (device == m_DevicesCollection.end())
+            continue;
+        auto miner = startMiner(device->second, kv.first);
+        if (!miner)
+            continue;
+        joinMiner(miner);
+        r.restartedAt = now;
+        cnote << "Restarted " << device->second.name << " (" << m_telemetry.miners.at(kv.first).prefix
+              << kv.first << ")";
+    }
+}
+
+/**
+ * @brief Shares the power budget out every 30 s. Miners which can't be limited,
+ *  are paused or not hashing keep what they draw. The others each get half their
+ *  demand to start with, the rest goes out by hashrate per watt, so the most
+ *  efficient boards run unlimited and the least efficient ones are held back.
+ *  Limits are resent every time, a restarted miner starts without one
+ */
+void Farm::balancePower()
+{
+    if (!m_Settings.powerBudget || !isMining())
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_lastPowerBalance < std::chrono::seconds(30))
+        return;
+    m_lastPowerBalance = now;
+
+    struct PowerShare
+    {
+        std::shared_ptr<Miner> miner;
+        float demand;
+        float efficiency;
+        float limit;
+    };
+    std::vector<PowerShare> shares;
+    double available = m_Settings.powerBudget;
+    double demanded = 0;
+    TelemetryType snapshot = Telemetry();
+    for (auto const& miner : getMiners())
+    {
+        auto const& telemetry = snapshot.miners.at(miner->Index());
+        float demand = miner->paused() ? 0.0f : miner->powerDemand();
+        if (demand <= 0)
+        {
+            available -= telemetry.sensors.powerW;
+            continue;
+        }
+        float power = telemetry.sensors.powerW > 0 ? (float)telemetry.sensors.powerW : demand;
+        shares.push_back({miner, demand, telemetry.hashrate / power, 0.0f});
+        demanded += demand;
+    }
+    if (shares.empty())
+        return;
+
+    std::sort(shares.begin(), shares.end(),
+        [](const PowerShare& a, const PowerShare& b) { return a.efficiency > b.efficiency; });
+
+    // Over budget even at the floors - everyone gets the same fraction of theirs
+    double floors = demanded / 2;
+    double scale = (floors > 0 && available < floors) ? std::max(available, 0.0) / floors : 1.0;
+    double spare = std::max(available - floors, 0.0);
+    for (auto& share : shares)
+    {
+        share.limit = share.demand / 2 * scale;
+        double extra = std::min((double)share.demand - share.limit, scale < 1.0 ? 0.0 : spare);
+        share.limit += extra;
+        spare -= extra;
+    }
+
+    ostringstream summary;
+    for (auto const& share : shares)
+    {
+        unsigned index = share.miner->Index();
+        // Whatever it asks for - no limit, so it is free to grow
+        float limit = (share.limit >= share.demand) ? 0.0f : share.limit;
+        share.miner->setPowerLimit(limit);
+        // Rounded to 10W so measurement noise doesn't flood the log
+        summary << " " << snapshot.miners.at(index).prefix << index << " "
+                << (limit > 0 ? to_string((int)(limit / 10) * 10) + "W" : string("unlimited"));
+    }
+    if (summary.str() != m_powerSummary)
+    {
+        m_powerSummary = summary.str();
+        cnote << "Power budget " << m_Settings.powerBudget << "W, demand " << (int)demanded
+              << "W of " << (int)std::max(available, 0.0) << "W left:" << m_powerSummary;
+    }
 }
 
 /**
@@ -359,6 +810,9 @@ void Farm::stop()
             m_isMining.store(false, std::memory_order_relaxed);
         }
     }
+
+    // Device adds and teardowns in flight use the miners and this, see them out
+    joinTracked();
     DEV_BUILD_LOG_PROGRAMFLOW(cnote, "Farm::stop() end");
 }
 
@@ -432,6 +886,7 @@ bool Farm::reboot(const std::vector<std::string>& args)
  */
 void Farm::accountSolution(unsigned _minerIdx, SolutionAccountingEnum _accounting)
 {
+    Guard l(x_telemetry);
     if (_accounting == SolutionAccountingEnum::Accepted)
     {
         m_telemetry.farm.solutions.accepted++;
@@ -480,6 +935,7 @@ void Farm::accountSolution(unsigned _minerIdx, SolutionAccountingEnum _accountin
 
 SolutionAccountType Farm::getSolutions()
 {
+    Guard l(x_telemetry);
     return m_telemetry.farm.solutions;
 }
 
@@ -488,6 +944,7 @@ SolutionAccountType Farm::getSolutions()
  */
 SolutionAccountType Farm::getSolutions(unsigned _minerIdx)
 {
+    Guard l(x_telemetry);
     try
     {
         return m_telemetry.miners.at(_minerIdx).solutions;
@@ -528,8 +985,14 @@ void Farm::submitProofAsync(Solution const& _s)
     if (!m_Settings.noEval)
     {
         Result r = EthashAux::eval(_s.work.epoch, _s.work.header, _s.nonce);
-	// SQRL fixed difficulty for health check
-	if ( (r.value > h256("0x000001ffffffffffffffffffffffffffffffffffffffffffffffffffffffffff")) && (r.value > _s.work.boundary))
+	// SQRL health check - 16x the target the device reported against, fixed if it didn't say
+	h256 healthLimit = h256("0x000001ffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+	if (_s.healthTarget)
+	{
+	    h256::Arith t = _s.healthTarget;
+	    healthLimit = (t > (~h256::Arith(0) >> 4)) ? h256(~h256::Arith(0)) : h256((t << 4) | 0xf);
+	}
+	if ( (r.value > healthLimit) && (r.value > _s.work.boundary))
         {
             accountSolution(_s.midx, SolutionAccountingEnum::Failed);
             cwarn << "Miner " << _s.midx
@@ -538,7 +1001,8 @@ void Farm::submitProofAsync(Solution const& _s)
         }
         if (r.value <= _s.work.boundary)
         {
-          m_onSolutionFound(Solution{_s.nonce, r.mixHash, _s.work, _s.tstamp, _s.midx});
+          m_onSolutionFound(
+              Solution{_s.nonce, r.mixHash, _s.work, _s.tstamp, _s.midx, _s.healthTarget});
 	}
 	else
        	{
@@ -566,17 +1030,21 @@ void Farm::collectData(const boost::system::error_code& ec)
     if (ec)
         return;
 
-    // Reset hashrate (it will accumulate from miners)
+    // Reset hashrate and power (they will accumulate from miners)
     float farm_hr = 0.0f;
+    double farm_power = 0.0;
 
-    // Process miners
-    for (auto const& miner : m_miners)
+    // Process miners, on a snapshot as miners may come and go meanwhile
+    for (auto const& miner : getMiners())
     {
         int minerIdx = miner->Index();
         float hr = (miner->paused() ? 0.0f : miner->RetrieveHashRate());
         farm_hr += hr;
-        m_telemetry.miners.at(minerIdx).hashrate = hr;
-        m_telemetry.miners.at(minerIdx).paused = miner->paused();
+        {
+            Guard t(x_telemetry);
+            m_telemetry.miners.at(minerIdx).hashrate = hr;
+            m_telemetry.miners.at(minerIdx).paused = miner->paused();
+        }
 
 
         if (m_Settings.hwMon)
@@ -584,6 +1052,7 @@ void Farm::collectData(const boost::system::error_code& ec)
             HwMonitorInfo hwInfo = miner->hwmonInfo();
 
             unsigned int tempC = 0, fanpcnt = 0, powerW = 0;
+            HwSensorsType sensors;
 
             if (hwInfo.deviceType == HwMonitorInfoType::NVIDIA && nvmlh)
             {
@@ -670,7 +1139,8 @@ void Farm::collectData(const boost::system::error_code& ec)
                 }
 #endif
             } else if (hwInfo.deviceType == HwMonitorInfoType::SQRL) {
-              miner->getTelemetry(&tempC, &fanpcnt, &powerW);
+              miner->getTelemetry(sensors);
+              tempC = sensors.tempC;
 	    }
 
 
@@ -685,14 +1155,29 @@ void Farm::collectData(const boost::system::error_code& ec)
                     miner->resume(MinerPauseEnum::PauseDueToOverHeating);
             }
 
-            m_telemetry.miners.at(minerIdx).sensors.tempC = tempC;
-            m_telemetry.miners.at(minerIdx).sensors.fanP = fanpcnt;
-            m_telemetry.miners.at(minerIdx).sensors.powerW = powerW / ((double)1000.0);
+            if (hwInfo.deviceType != HwMonitorInfoType::SQRL)
+            {
+                sensors.tempC = tempC;
+                sensors.fanP = fanpcnt;
+                sensors.powerW = powerW / ((double)1000.0);
+            }
+            {
+                Guard t(x_telemetry);
+                m_telemetry.miners.at(minerIdx).sensors = sensors;
+            }
+            farm_power += sensors.powerW;
+        }
+        {
+            Guard t(x_telemetry);
+            m_telemetry.farm.hashrate = farm_hr;
+            m_telemetry.farm.sensors.powerW = farm_power;
         }
-        m_telemetry.farm.hashrate = farm_hr;
         miner->TriggerHashRateUpdate();
     }
 
+    superviseMiners();
+    balancePower();
+
     // Resubmit timer for another loop
     m_collectTimer.expires_from_now(boost::posix_time::milliseconds(m_collectInterval));
     m_collectTimer.async_wait(
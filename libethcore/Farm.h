@@ -18,6 +18,8 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <list>
 #include <thread>
 
@@ -50,12 +52,21 @@ namespace eth
 {
 struct FarmSettings
 {
-    unsigned dagLoadMode = 0;  // 0 = Parallel; 1 = Serialized
+    unsigned dagLoadMode = 0;  // 0 = Parallel; 1 = Serialized; 2 = Scheduled
+    unsigned dagLoadConcurrency = 0;  // Max concurrent DAG loads in scheduled mode (0 = from power)
+    unsigned dagLoadPower = 0;        // Watts available for DAG loads in scheduled mode
+    unsigned dagLoadWatts = 100;      // Watts drawn by one device while loading its DAG
     bool noEval = false;       // Whether or not to re-evaluate solutions
     unsigned hwMon = 0;        // 0 - No monitor; 1 - Temp and Fan; 2 - Temp Fan Power
     unsigned ergodicity = 0;   // 0=default, 1=per session, 2=per job
     unsigned tempStart = 40;   // Temperature threshold to restart mining (if paused)
     unsigned tempStop = 0;     // Temperature threshold to pause mining (overheating)
+    unsigned epochPrestage = 0;  // Blocks before an epoch boundary to prepare the next epoch (0 = off)
+    unsigned statsOutliers = 2;        // Hashrate samples far from the median: 0 = Keep; 1 = Clip; 2 = Drop
+    double statsOutlierFactor = 3.0;  // How far from the median (times or fraction) is an outlier
+    unsigned minerRestarts = 5;        // Restarts of a failed miner within an hour before giving up (0 = no supervision)
+    unsigned minerStuckTimeout = 300;  // Seconds without progress before a miner counts as failed (0 = exited only)
+    unsigned powerBudget = 0;          // Watts all miners together may draw (0 = no budget)
 };
 
 /**
@@ -138,7 +149,11 @@ public:
      * @brief Get information on the progress of mining this work package.
      * @return The progress with mining so far.
      */
-    TelemetryType& Telemetry() { return m_telemetry; }
+    TelemetryType Telemetry()
+    {
+        Guard l(x_telemetry);
+        return m_telemetry;
+    }
 
     /**
      * @brief Gets current hashrate
@@ -148,28 +163,46 @@ public:
     /**
      * @brief Gets the collection of pointers to miner instances
      */
-    std::vector<std::shared_ptr<Miner>> getMiners() { return m_miners; }
+    std::vector<std::shared_ptr<Miner>> getMiners()
+    {
+        Guard l(x_minerWork);
+        return m_miners;
+    }
 
     /**
      * @brief Gets the number of miner instances
      */
-    unsigned getMinersCount() { return (unsigned)m_miners.size(); };
+    unsigned getMinersCount()
+    {
+        Guard l(x_minerWork);
+        return (unsigned)m_miners.size();
+    };
 
     /**
-     * @brief Gets the pointer to a miner instance
+     * @brief Gets the pointer to a miner instance by its index
      */
     std::shared_ptr<Miner> getMiner(unsigned index)
     {
-        try
-        {
-            return m_miners.at(index);
-        }
-        catch (const std::exception&)
-        {
-            return nullptr;
-        }
+        Guard l(x_minerWork);
+        for (auto const& miner : m_miners)
+            if (miner->Index() == index)
+                return miner;
+        return nullptr;
     }
 
+    /**
+     * @brief Probes a SQRL board and, if it answers and isn't mined already,
+     *  starts a miner on it in background. The other miners are not touched
+     * @return false (with the reason in _error) if the request is refused upfront
+     */
+    bool addSqrlDevice(const std::string& _host, unsigned _port, std::string& _error);
+
+    /**
+     * @brief Stops a single miner and drops its device from the farm.
+     *  The other miners keep mining in their nonce segments
+     */
+    bool removeMiner(unsigned _index);
+
     /**
      * @brief Accounts a solution to a miner and, as a consequence, to
      *  the whole farm
@@ -259,11 +292,71 @@ private:
      */
     bool spawn_file_in_bin_dir(const char* filename, const std::vector<std::string>& args);
 
+    // Creates and starts the miner of a device in the given telemetry slot
+    std::shared_ptr<Miner> startMiner(DeviceDescriptor& _device, unsigned index);
+
+    // Restarts failed miners with backoff, see FarmSettings::minerRestarts
+    void superviseMiners();
+
+    // Shares FarmSettings::powerBudget out among the miners which can be limited
+    void balancePower();
+
+    // Hands the current work to a miner, in the nonce segment of its index
+    void assignWork(const std::shared_ptr<Miner>& _miner);
+
+    // Switches serialized DAG loads to scheduled ones with a single slot
+    void leaveSerializedDagLoads();
+
+    // Brings a miner started while mining up to the current epoch and work
+    void joinMiner(const std::shared_ptr<Miner>& _miner);
+
+    // Fills an EpochContext from an ethash context
+    static EpochContext makeEpochContext(int _epoch, const ethash::epoch_context& _ec);
+
+    // Builds the next epoch's context in background and hands it to the miners
+    void prestageEpoch(int _epoch, std::vector<std::shared_ptr<Miner>> _miners);
+
+    // Runs a task on a thread of its own which stop() and the destructor wait for
+    void spawnTracked(std::function<void()> _task);
+
+    // Waits until every task of spawnTracked has returned
+    void joinTracked();
+
     mutable Mutex x_minerWork;
     std::vector<std::shared_ptr<Miner>> m_miners;  // Collection of miners
 
+    // Guards m_telemetry, which miner and io threads read without x_minerWork. Taken
+    // after x_minerWork, never before. Its size only changes under both
+    mutable Mutex x_telemetry;
+
     WorkPackage m_currentWp;
+    uint64_t m_currentStartNonce = 0;  // Nonce of segment 0 for m_currentWp
     EpochContext m_currentEc;
+    std::shared_ptr<const ethash::epoch_context> m_currentContext;  // Keeps a pre-staged light cache alive
+
+    // Supervision state of a miner slot
+    struct MinerRecovery
+    {
+        std::string uniqueId;  // Device of the failed miner
+        std::shared_ptr<std::atomic<bool>> tornDown;  // Set once the failed instance is destroyed
+        std::chrono::steady_clock::time_point retryAt;
+        std::chrono::steady_clock::time_point restartedAt;
+        std::list<std::chrono::steady_clock::time_point> restarts;  // Within the last hour
+        unsigned failuresInRow = 0;
+        bool givenUp = false;
+    };
+    std::map<unsigned, MinerRecovery> m_recovery;  // By miner index
+
+    std::chrono::steady_clock::time_point m_lastPowerBalance;
+    std::string m_powerSummary;  // Limits last logged
+
+    std::thread m_prestageThread;
+
+    // Device adds and miner teardowns still running, they use this and the miners
+    Mutex x_tracked;
+    std::condition_variable m_trackedDone;
+    unsigned m_trackedThreads = 0;
+    std::atomic<int> m_prestageEpoch = {-1};
 
     std::atomic<bool> m_isMining = {false};
 
@@ -292,6 +385,10 @@ private:
     uint64_t m_nonce_scrambler;
     unsigned int m_nonce_segment_with = 32;
 
+    // Telemetry slots reserved on top of the devices found at start. Miners keep reading
+    // their own slot, so hot-added miners must never make the vector reallocate
+    static const unsigned m_spareMinerSlots = 64;
+
     // Wrappers for hardware monitoring libraries and their mappers
     wrap_nvml_handle* nvmlh = nullptr;
     std::map<string, int> map_nvml_handle = {};
@@ -0,0 +1,215 @@
+/*
+ This file is part of ethminer.
+
+ ethminer is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ethminer is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ethminer.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "HashRateStats.h"
+
+using namespace std;
+using namespace dev;
+using namespace eth;
+
+static const chrono::seconds c_slotDuration(10);
+static const unsigned c_tier0PerTier1 = 6;   // 10 s samples per 1 min sample
+static const unsigned c_tier1PerTier2 = 10;  // 1 min samples per 10 min sample
+static const size_t c_maxGapSlots = 8640;    // 24 h of 10 s slots
+
+StatsOutlierMode HashRateStats::s_outlierMode = StatsOutlierMode::Drop;
+double HashRateStats::s_outlierFactor = 3.0;
+
+void StatsRing::push(double _value)
+{
+    m_samples[m_head] = _value;
+    m_head = (m_head + 1) % m_samples.size();
+    if (m_count < m_samples.size())
+        m_count++;
+}
+
+void StatsRing::clear()
+{
+    m_head = 0;
+    m_count = 0;
+}
+
+double StatsRing::at(size_t _age) const
+{
+    if (_age >= m_count)
+        return 0;
+    return m_samples[(m_head + m_samples.size() - 1 - _age) % m_samples.size()];
+}
+
+vector<double> StatsRing::last(size_t _last) const
+{
+    size_t n = (_last == 0 || _last > m_count) ? m_count : _last;
+    vector<double> ret(n);
+    for (size_t i = 0; i < n; i++)
+        ret[i] = at(n - 1 - i);
+    return ret;
+}
+
+static HashRateWindow summarize(vector<double> _samples)
+{
+    HashRateWindow w;
+    w.samples = _samples.size();
+    if (_samples.empty())
+        return w;
+
+    sort(_samples.begin(), _samples.end());
+    double sum = 0;
+    for (auto v : _samples)
+        sum += v;
+    auto percentile = [&](double p) {
+        return _samples[(size_t)round(p * (_samples.size() - 1))];
+    };
+    w.mean = sum / _samples.size();
+    w.min = _samples.front();
+    w.max = _samples.back();
+    w.p5 = percentile(0.05);
+    w.p50 = percentile(0.5);
+    w.p95 = percentile(0.95);
+    return w;
+}
+
+void HashRateStats::setOutlierPolicy(StatsOutlierMode _mode, double _factor)
+{
+    s_outlierMode = _mode;
+    s_outlierFactor = (_factor > 1.0) ? _factor : 1.0;
+}
+
+const char* HashRateStats::windowName(Window _window)
+{
+    static const char* names[WindowCount] = {"10s", "1m", "10m", "1h", "24h"};
+    return (_window < WindowCount) ? names[_window] : "";
+}
+
+void HashRateStats::add(double _hashes, chrono::steady_clock::time_point _now)
+{
+    lock_guard<mutex> l(m_mutex);
+    if (!m_started)
+    {
+        m_started = true;
+        m_slotStart = _now;
+    }
+    m_slotHashes += _hashes;
+
+    auto elapsed = _now - m_slotStart;
+    if (elapsed < c_slotDuration)
+        return;
+
+    // A late call closes every slot it spans at the same average rate
+    double seconds = chrono::duration_cast<chrono::milliseconds>(elapsed).count() / 1000.0;
+    double rate = m_slotHashes / seconds;
+    size_t slots = min((size_t)(elapsed / c_slotDuration), c_maxGapSlots);
+    for (size_t i = 0; i < slots; i++)
+        pushSample(rate);
+
+    m_slotStart = _now;
+    m_slotHashes = 0;
+}
+
+void HashRateStats::pushSample(double _rate)
+{
+    bool keep = true;
+    // The band follows every sample, so a lasting change is taken in once it
+    // makes up half the window instead of being dropped for good
+    m_raw.push(_rate);
+    if (s_outlierMode != StatsOutlierMode::Keep && m_raw.size() > c_tier0PerTier1)
+    {
+        double median = summarize(m_raw.last()).p50;
+        double low = median / s_outlierFactor;
+        double high = median * s_outlierFactor;
+        if (_rate < low || _rate > high)
+        {
+            if (s_outlierMode == StatsOutlierMode::Clip)
+                _rate = max(low, min(high, _rate));
+            else
+                keep = false;
+        }
+    }
+
+    if (keep)
+    {
+        m_tier0.push(_rate);
+        m_tier0Sum += _rate;
+        m_tier0Kept++;
+
+        // 1 min time constant on 10 s samples
+        static const double alpha = 1.0 - exp(-10.0 / 60.0);
+        m_ewma = (m_ewma == 0) ? _rate : m_ewma + alpha * (_rate - m_ewma);
+    }
+
+    // Roll up by slot count so dropped samples still advance time
+    if (++m_tier0Slots < c_tier0PerTier1)
+        return;
+    if (m_tier0Kept)
+    {
+        double rate = m_tier0Sum / m_tier0Kept;
+        m_tier1.push(rate);
+        m_tier1Sum += rate;
+        m_tier1Kept++;
+    }
+    m_tier0Slots = m_tier0Kept = 0;
+    m_tier0Sum = 0;
+
+    if (++m_tier1Slots < c_tier1PerTier2)
+        return;
+    if (m_tier1Kept)
+        m_tier2.push(m_tier1Sum / m_tier1Kept);
+    m_tier1Slots = m_tier1Kept = 0;
+    m_tier1Sum = 0;
+}
+
+void HashRateStats::reset()
+{
+    lock_guard<mutex> l(m_mutex);
+    m_raw.clear();
+    m_tier0.clear();
+    m_tier1.clear();
+    m_tier2.clear();
+    m_started = false;
+    m_slotHashes = 0;
+    m_tier0Slots = m_tier0Kept = m_tier1Slots = m_tier1Kept = 0;
+    m_tier0Sum = m_tier1Sum = 0;
+    m_ewma = 0;
+}
+
+HashRateWindow HashRateStats::window(Window _window) const
+{
+    lock_guard<mutex> l(m_mutex);
+    switch (_window)
+    {
+    case Sec10:
+        return summarize(m_tier0.last(1));
+    case Min1:
+        return summarize(m_tier0.last(c_tier0PerTier1));
+    case Min10:
+        return summarize(m_tier0.last());
+    case Hour1:
+        return summarize(m_tier1.last());
+    case Hour24:
+        return summarize(m_tier2.last());
+    default:
+        return HashRateWindow();
+    }
+}
+
+double HashRateStats::ewma() const
+{
+    lock_guard<mutex> l(m_mutex);
+    return m_ewma;
+}
@@ -0,0 +1,152 @@
+/*
+ This file is part of ethminer.
+
+ ethminer is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ethminer is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ethminer.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace dev
+{
+namespace eth
+{
+enum class StatsOutlierMode : uint8_t
+{
+    Keep,  // Every sample counts
+    Clip,  // Samples out of band are clamped to the band
+    Drop   // Samples out of band are discarded
+};
+
+/**
+ * @brief Fixed capacity ring of samples, newest overwrites oldest
+ */
+class StatsRing
+{
+public:
+    explicit StatsRing(size_t _capacity) : m_samples(_capacity) {}
+
+    void push(double _value);
+    void clear();
+
+    size_t size() const { return m_count; }
+
+    /**
+     * @brief Sample _age pushes ago (0 = newest)
+     */
+    double at(size_t _age) const;
+
+    /**
+     * @brief Newest _last samples (all if 0), oldest first
+     */
+    std::vector<double> last(size_t _last = 0) const;
+
+private:
+    std::vector<double> m_samples;
+    size_t m_head = 0;
+    size_t m_count = 0;
+};
+
+struct HashRateWindow
+{
+    double mean = 0;
+    double min = 0;
+    double max = 0;
+    double p5 = 0;
+    double p50 = 0;
+    double p95 = 0;
+    size_t samples = 0;
+};
+
+/**
+ * @brief Hashrate statistics over several windows in fixed memory.
+ * Hashes are accumulated into 10 s samples, which are rolled up into 1 min
+ * and 10 min samples so the longer windows need no more memory than the short ones.
+ * @threadsafe
+ */
+class HashRateStats
+{
+public:
+    enum Window
+    {
+        Sec10,
+        Min1,
+        Min10,
+        Hour1,
+        Hour24,
+        WindowCount
+    };
+
+    HashRateStats() = default;
+
+    /**
+     * @brief Accounts hashes done up to _now
+     */
+    void add(double _hashes,
+        std::chrono::steady_clock::time_point _now = std::chrono::steady_clock::now());
+
+    void reset();
+
+    /**
+     * @brief Statistics of a window, rates in hashes per second
+     */
+    HashRateWindow window(Window _window) const;
+
+    double mean(Window _window) const { return window(_window).mean; }
+
+    /**
+     * @brief Exponentially weighted rate, 1 min time constant
+     */
+    double ewma() const;
+
+    static const char* windowName(Window _window);
+
+    /**
+     * @brief How samples far from the 10 min median are treated, for all instances
+     */
+    static void setOutlierPolicy(StatsOutlierMode _mode, double _factor);
+
+private:
+    void pushSample(double _rate);
+
+    mutable std::mutex m_mutex;
+
+    StatsRing m_raw{60};     // 10 s samples as measured, dropped ones too - the outlier reference
+    StatsRing m_tier0{60};   // 10 s samples, 10 min
+    StatsRing m_tier1{60};   // 1 min samples, 1 h
+    StatsRing m_tier2{144};  // 10 min samples, 24 h
+
+    bool m_started = false;
+    std::chrono::steady_clock::time_point m_slotStart;
+    double m_slotHashes = 0;
+
+    // Roll-up accumulators of the next tier 1 and tier 2 samples
+    unsigned m_tier0Slots = 0;
+    unsigned m_tier0Kept = 0;
+    double m_tier0Sum = 0;
+    unsigned m_tier1Slots = 0;
+    unsigned m_tier1Kept = 0;
+    double m_tier1Sum = 0;
+
+    double m_ewma = 0;
+
+    static StatsOutlierMode s_outlierMode;
+    static double s_outlierFactor;
+};
+
+}  // namespace eth
+}  // namespace dev
@@ -25,6 +25,13 @@ namespace eth
 unsigned Miner::s_dagLoadMode = 0;
 unsigned Miner::s_dagLoadIndex = 0;
 unsigned Miner::s_minersCount = 0;
+unsigned Miner::s_dagLoadConcurrency = 1;
+
+boost::mutex Miner::s_dagSchedMutex;
+boost::condition_variable Miner::s_dagSchedSignal;
+std::list<Miner*> Miner::s_dagLoadQueue;
+unsigned Miner::s_dagLoadActive = 0;
+uint64_t Miner::s_dagLoadAvgMs = 0;
 
 FarmFace* FarmFace::m_this = nullptr;
 
@@ -53,11 +60,9 @@ void Miner::setWork(WorkPackage const& _work)
     kick_miner();
 }
 
-void Miner::getTelemetry(unsigned int *tempC, unsigned int *fanprc, unsigned int *powerW)
+void Miner::getTelemetry(HwSensorsType& _sensors)
 {
-    (*tempC)=0;
-    (*fanprc)=0;
-    (*powerW)=0;
+    _sensors = HwSensorsType();
 }
 
 void Miner::pause(MinerPauseEnum what) 
@@ -144,21 +149,37 @@ bool Miner::initEpoch()
     // this instance to become current
     if (s_dagLoadMode == DAG_LOAD_MODE_SEQUENTIAL)
     {
-        while (s_dagLoadIndex < m_index)
+        // The farm may switch to scheduled loads while we wait (devices added/removed)
+        while (s_dagLoadMode == DAG_LOAD_MODE_SEQUENTIAL && s_dagLoadIndex < m_index)
         {
             boost::system_time const timeout =
                 boost::get_system_time() + boost::posix_time::seconds(3);
             boost::mutex::scoped_lock l(x_work);
             m_dag_loaded_signal.timed_wait(l, timeout);
+            if (m_heartbeatMs)
+                heartbeat();
         }
         if (shouldStop())
             return false;
     }
 
+    // When loading of DAG is scheduled wait for a free
+    // slot, unless the device already holds this epoch
+    bool scheduled = false;
+    if (s_dagLoadMode == DAG_LOAD_MODE_SCHEDULED && !isDagReady(m_epochContext.epochNumber))
+    {
+        if (!acquireDagLoadSlot())
+            return false;
+        scheduled = true;
+    }
+
     // Run the internal initialization
     // specific for miner
     bool result = initEpoch_internal();
 
+    if (scheduled)
+        releaseDagLoadSlot();
+
     // Advance to next miner or reset to zero for 
     // next run if all have processed
     if (s_dagLoadMode == DAG_LOAD_MODE_SEQUENTIAL)
@@ -173,6 +194,95 @@ bool Miner::initEpoch()
     return result;
 }
 
+bool Miner::dagLoadsBefore(const Miner* _other) const
+{
+    // Fastest miners first so the most hashrate comes back soonest
+    if (m_dagLoadPriority != _other->m_dagLoadPriority)
+        return m_dagLoadPriority > _other->m_dagLoadPriority;
+    return m_index < _other->m_index;
+}
+
+bool Miner::acquireDagLoadSlot()
+{
+    boost::mutex::scoped_lock l(s_dagSchedMutex);
+    m_dagLoadPriority = expectedHashRate();
+    m_dagLoadState = DagLoadState::Queued;
+    s_dagLoadQueue.push_back(this);
+
+    while (true)
+    {
+        if (shouldStop())
+        {
+            s_dagLoadQueue.remove(this);
+            m_dagLoadState = DagLoadState::Idle;
+            s_dagSchedSignal.notify_all();
+            return false;
+        }
+
+        if (s_dagLoadActive < s_dagLoadConcurrency)
+        {
+            bool first = true;
+            for (auto const& m : s_dagLoadQueue)
+            {
+                if (m != this && m->dagLoadsBefore(this))
+                {
+                    first = false;
+                    break;
+                }
+            }
+            if (first)
+                break;
+        }
+
+        s_dagSchedSignal.timed_wait(l, boost::posix_time::seconds(3));
+        if (m_heartbeatMs)
+            heartbeat();  // Queued is not stuck
+    }
+
+    s_dagLoadQueue.remove(this);
+    s_dagLoadActive++;
+    m_dagLoadStart = std::chrono::steady_clock::now();
+    m_dagLoadState = DagLoadState::Loading;
+    return true;
+}
+
+void Miner::releaseDagLoadSlot()
+{
+    boost::mutex::scoped_lock l(s_dagSchedMutex);
+    uint64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - m_dagLoadStart)
+                      .count();
+    s_dagLoadAvgMs = (s_dagLoadAvgMs ? (s_dagLoadAvgMs * 3 + ms) / 4 : ms);
+    s_dagLoadActive--;
+    m_dagLoadState = DagLoadState::Idle;
+    s_dagSchedSignal.notify_all();
+}
+
+int Miner::getDagLoadEta()
+{
+    boost::mutex::scoped_lock l(s_dagSchedMutex);
+    DagLoadState state = m_dagLoadState;
+    if (state == DagLoadState::Idle)
+        return 0;
+    if (!s_dagLoadAvgMs)
+        return -1;
+
+    if (state == DagLoadState::Loading)
+    {
+        int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - m_dagLoadStart)
+                              .count();
+        return (int)(std::max<int64_t>(0, (int64_t)s_dagLoadAvgMs - elapsed) / 1000);
+    }
+
+    // Queued - count the miners admitted ahead of us
+    unsigned ahead = 0;
+    for (auto const& m : s_dagLoadQueue)
+        if (m != this && m->dagLoadsBefore(this))
+            ahead++;
+    return (int)((ahead / s_dagLoadConcurrency + 1) * s_dagLoadAvgMs / 1000);
+}
+
 WorkPackage Miner::work() const
 {
     boost::mutex::scoped_lock l(x_work);
@@ -181,6 +291,7 @@ WorkPackage Miner::work() const
 
 void Miner::updateHashRate(uint32_t _groupSize, uint32_t _increment) noexcept
 {
+    m_hashStats.add((double)_increment * _groupSize);
     m_groupCount += _increment;
     bool b = true;
     if (!m_hashRateUpdate.compare_exchange_strong(b, false))
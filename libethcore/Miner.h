@@ -23,6 +23,7 @@
 #include <string>
 
 #include "EthashAux.h"
+#include "HashRateStats.h"
 #include <libdevcore/Common.h>
 #include <libdevcore/Log.h>
 #include <libdevcore/Worker.h>
@@ -32,6 +33,7 @@
 
 #define DAG_LOAD_MODE_PARALLEL 0
 #define DAG_LOAD_MODE_SEQUENTIAL 1
+#define DAG_LOAD_MODE_SCHEDULED 2
 
 using namespace std;
 
@@ -83,6 +85,13 @@ enum class ClPlatformTypeEnum
     Nvidia
 };
 
+enum class DagLoadState
+{
+    Idle,
+    Queued,
+    Loading
+};
+
 enum class SolutionAccountingEnum
 {
     Accepted,
@@ -131,22 +140,40 @@ struct SQSettings : public MinerSettings
    unsigned patience = 1;
    bool skipStallDetection = 1;
    unsigned workDelay = 50000;
+   unsigned statusInterval = 1000; // Milliseconds between hashcore counter polls
+   bool healthMonitor = false; // Statistical stall/degradation detection
+   double healthShareRate = 0; // Health shares per second to aim for, 0 == fixed target
+   unsigned healthStallAction = 2; // 0 - none, 1 - alert, 2 - reset core, 3 - downclock, 4 - re-DAG
+   unsigned healthDegradeAction = 1;
+   unsigned healthErrorAction = 3;
+   unsigned healthLinkAction = 1;
    unsigned fkVCCINT = 0;  // 0 == no action
    unsigned jcVCCINT = 0;  // 0 == no action
    bool dieOnError = false;
-   unsigned dagMixers = 16;
+   unsigned dagMixers = 0; // 0 == as reported by the bitstream (16 if it doesn't)
    unsigned autoTune = 0;// 0 - no auto-tune, 1 - just reach max stable freq, 2 - downclock till low errror rate, 3 - tune intensity, 4- downclock voltage
    unsigned tuneTime = 60;
+   unsigned tuneStrategy = 0; // 0 - staged tune, 1 - successive halving over clock, N, D and patience
    unsigned tuneMaxClk = 600;
+   unsigned tuneMinVCCINT = 720; // Stage 4 will not take VCCINT below this, mV
    bool showHBMStats = true;
    bool forceDAG = false; 
    bool skipDAG = false; // DEV - 'fake' building dag to test hashrate only
+   unsigned dagVerifySamples = 0; // 0 == no DAG verification, else items sampled per HBM stack
+   unsigned dagVerifyInterval = 0; // Minutes between periodic DAG checks, 0 == after generation only
    vector<uint8_t> exclude;
    unsigned axiTimeoutMs = 2000;
+   unsigned probeTimeoutMs = 3000; // Discovery connect/probe timeout, 0 == no discovery
    vector<uint8_t> tuneExclude;
    string tuneFile = "tune.txt";
+   bool warmAttach = false; // Resume a board left configured by a previous run without re-init
+   string stateFile = "sqrlstate.txt";
    unsigned tuneMaxCoreTemp = 85;
    unsigned tuneMaxHBMtemp = 80;
+   unsigned thermalCoreTarget = 0; // Thermal governor core target in C, 0 == not governed
+   unsigned thermalHBMTarget = 0;  // Thermal governor HBM target in C, 0 == not governed
+   unsigned thermalMaxDerate = 30; // Percent of throughput the governor takes off before downclocking
+   unsigned thermalHysteresis = 2; // Degrees either side of a target the governor holds still
 };
 
 struct SolutionAccountType
@@ -177,11 +204,19 @@ struct HwSensorsType
     int tempC = 0;
     int fanP = 0;
     double powerW = 0.0;
+    double voltage = 0.0;   // Core voltage, devices reporting it (SQRL)
+    double clockMHz = 0.0;  // Core clock, devices reporting it (SQRL)
     string str()
     {
-        string _ret = to_string(tempC) + "C " + to_string(fanP) + "MHz";
+        string _ret = to_string(tempC) + "C";
+        if (clockMHz)
+            _ret.append(boost::str(boost::format(" %0.0fMHz") % clockMHz));
+        else
+            _ret.append(" " + to_string(fanP) + "%");
+        if (voltage)
+            _ret.append(boost::str(boost::format(" %0.2fV") % voltage));
         if (powerW)
-            _ret.append(boost::str(boost::format(" %0.2fV") % powerW));
+            _ret.append(boost::str(boost::format(" %0.2fW") % powerW));
         return _ret;
     };
 };
@@ -193,6 +228,13 @@ struct TelemetryAccountType
     bool paused = false;
     HwSensorsType sensors;
     SolutionAccountType solutions;
+    bool removed = false;  // Device removed at runtime, slot kept for stable indexes
+
+    // MH/J, 0 if power is unknown
+    double efficiency() const
+    {
+        return (sensors.powerW > 0) ? (hashrate / 1e6) / sensors.powerW : 0;
+    }
 };
 
 struct DeviceDescriptor
@@ -239,6 +281,7 @@ struct DeviceDescriptor
     string sqHost;
     unsigned int sqPort;
     double targetClk;
+    string sqDNA;  // From the discovery probe, empty if not probed
 };
 
 struct HwMonitorInfo
@@ -317,13 +360,21 @@ struct TelemetryType
         }
 
         _ret << EthTealBold << std::fixed << std::setprecision(2) << hr << " "
-             << suffixes[magnitude] << EthReset << " - ";
+             << suffixes[magnitude] << EthReset;
+        if (hwmon && farm.sensors.powerW > 0)
+            _ret << " " << EthTealBold << std::setprecision(0) << farm.sensors.powerW << "W "
+                 << std::setprecision(3) << farm.efficiency() << "MH/J" << EthReset;
+        _ret << " - ";
 
         int i = -1;                 // Current miner index
         int m = miners.size() - 1;  // Max miner index
+        while (m >= 0 && miners[m].removed)
+            m--;
         for (TelemetryAccountType miner : miners)
         {
             i++;
+            if (miner.removed)
+                continue;
             hr = miner.hashrate;
             if (hr > 0.0f)
                 hr /= pow(1000.0f, magnitude);
@@ -332,7 +383,12 @@ struct TelemetryType
                  << std::fixed << std::setprecision(2) << hr << EthReset;
 
             if (hwmon)
+            {
                 _ret << " " << EthTeal << miner.sensors.str() << EthReset;
+                if (miner.efficiency())
+                    _ret << " " << EthTeal << std::setprecision(3) << miner.efficiency()
+                         << "MH/J" << EthReset;
+            }
 
             // Eventually push also solutions per single GPU
             if (g_logOptions & LOG_PER_GPU)
@@ -393,11 +449,12 @@ public:
     ~Miner() override = default;
 
     // Sets basic info for eventual serialization of DAG load
-    static void setDagLoadInfo(unsigned _mode, unsigned _devicecount)
+    static void setDagLoadInfo(unsigned _mode, unsigned _devicecount, unsigned _concurrency = 1)
     {
         s_dagLoadMode = _mode;
         s_dagLoadIndex = 0;
         s_minersCount = _devicecount;
+        s_dagLoadConcurrency = std::max(1U, _concurrency);
     };
 
     /**
@@ -415,13 +472,19 @@ public:
      */
     void setEpoch(EpochContext const& _ec) { m_epochContext = _ec; }
 
+    /**
+     * @brief Lets the miner prepare for the next epoch ahead of the switch.
+     * Called from the farm's pre-staging thread, must not touch the current work.
+     */
+    virtual void prestageEpoch(EpochContext const& _ec) { (void)_ec; }
+
     unsigned Index() { return m_index; };
 
     HwMonitorInfo hwmonInfo() { return m_hwmoninfo; }
 
     void setHwmonDeviceIndex(int i) { m_hwmoninfo.deviceIndex = i; }
 
-    virtual void getTelemetry(unsigned int *tempC, unsigned int *fanprc, unsigned int *powerW);
+    virtual void getTelemetry(HwSensorsType& _sensors);
 
     /**
      * @brief Kick an asleep miner.
@@ -461,6 +524,56 @@ public:
 
     void TriggerHashRateUpdate() noexcept;
 
+    /**
+     * @brief Multi-window statistics of the hashrate reported by this miner
+     */
+    HashRateStats const& hashRateStats() const { return m_hashStats; }
+
+    /**
+     * @brief Hashrate expected once mining, used to order scheduled DAG loads
+     */
+    virtual float expectedHashRate() { return RetrieveHashRate(); }
+
+    /**
+     * @brief Host to device bus transactions per second (0 if not tracked)
+     */
+    virtual float getBusOpsRate() { return 0.0f; }
+
+    /**
+     * @brief Watts this miner may draw under the farm's power budget, 0 for no limit
+     */
+    virtual void setPowerLimit(float _watts) { (void)_watts; }
+
+    /**
+     * @brief Watts this miner would draw without a limit (0 if it can't be limited)
+     */
+    virtual float powerDemand() { return 0.0f; }
+
+    /**
+     * @brief Where this miner is in the DAG load schedule
+     */
+    DagLoadState getDagLoadState() { return m_dagLoadState; }
+
+    /**
+     * @brief Milliseconds since the worker last showed progress, -1 if the miner
+     *  doesn't report it
+     */
+    int64_t heartbeatAge()
+    {
+        int64_t last = m_heartbeatMs.load(std::memory_order_relaxed);
+        if (!last)
+            return -1;
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+                   .count() -
+               last;
+    }
+
+    /**
+     * @brief Estimated seconds until this miner's DAG is loaded (0 if loaded, -1 if unknown)
+     */
+    int getDagLoadEta();
+
 protected:
     /**
      * @brief Initializes miner's device.
@@ -477,6 +590,16 @@ protected:
      */
     virtual bool initEpoch_internal() = 0;
 
+    /**
+     * @brief Whether the device already holds the DAG for the given epoch.
+     * Such miners bypass the DAG load scheduler.
+     */
+    virtual bool isDagReady(int _epoch)
+    {
+        (void)_epoch;
+        return false;
+    }
+
     /**
      * @brief Returns current workpackage this miner is working on
      */
@@ -484,10 +607,20 @@ protected:
 
     void updateHashRate(uint32_t _groupSize, uint32_t _increment) noexcept;
 
+    // Called by miners from their loops so the farm can tell a stuck worker from a slow one
+    void heartbeat()
+    {
+        m_heartbeatMs.store(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now().time_since_epoch())
+                                .count(),
+            std::memory_order_relaxed);
+    }
+
     static unsigned s_minersCount;   // Total Number of Miners
     static unsigned s_dagLoadMode;   // Way dag should be loaded
     static unsigned s_dagLoadIndex;  // In case of serialized load of dag this is the index of miner
                                      // which should load next
+    static unsigned s_dagLoadConcurrency;  // Max miners loading dag at once (scheduled mode)
 
     const unsigned m_index = 0;           // Ordinal index of the Instance (not the device)
     DeviceDescriptor m_deviceDescriptor;  // Info about the device
@@ -505,6 +638,22 @@ protected:
     boost::condition_variable m_dag_loaded_signal;
 
 private:
+    bool acquireDagLoadSlot();
+    void releaseDagLoadSlot();
+    bool dagLoadsBefore(const Miner* _other) const;
+
+    // Scheduled DAG load bookkeeping, shared by all miners
+    static boost::mutex s_dagSchedMutex;
+    static boost::condition_variable s_dagSchedSignal;
+    static std::list<Miner*> s_dagLoadQueue;
+    static unsigned s_dagLoadActive;
+    static uint64_t s_dagLoadAvgMs;
+
+    std::atomic<DagLoadState> m_dagLoadState = {DagLoadState::Idle};
+    std::atomic<int64_t> m_heartbeatMs = {0};
+    float m_dagLoadPriority = 0.0f;
+    std::chrono::steady_clock::time_point m_dagLoadStart;
+
     bitset<MinerPauseEnum::Pause_MAX> m_pauseFlags;
 
     WorkPackage m_work;
@@ -513,6 +662,7 @@ private:
     std::atomic<float> m_hashRate = {0.0};
     uint64_t m_groupCount = 0;
     atomic<bool> m_hashRateUpdate = {false};
+    HashRateStats m_hashStats;
 };
 
 }  // namespace eth